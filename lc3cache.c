@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "lc3cache.h"
+#include "lc3internal.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define RESULT_PATH_SIZE (CACHE_PATH_SIZE + 24) // dir/<16 hex digits>.lc3r
+#define TEMP_PATH_SIZE (RESULT_PATH_SIZE + 24)  // result path.<pid>
+
+/* Input and output of a run that is being recorded.*/
+typedef struct stream_s {
+  const char *input;
+  size_t inputLen, pos;
+  Result *result;
+  size_t outCap;
+} Stream;
+
+/* Everything a run starts from but the input bytes, stored to verify a hit.*/
+typedef struct key_s {
+  Register memory[MEM_SIZE];
+  CPU_s cpus;
+  Timing timing;
+  unsigned long instructions; // counters and cache the run continues from
+  Perf perf;
+  int cacheTag[TIMING_MAX_LINES];
+  unsigned long budget;
+  unsigned long inputLen;
+} Key;
+
+/* On-disk layout of a result, followed by key.inputLen bytes of input and
+   outputLen bytes of output.*/
+typedef struct record_s {
+  char magic[4];
+  char version[12];
+  Key key;
+  int status;
+  CPU_s cpus;
+  Register memory[MEM_SIZE];
+  unsigned long instructions;
+  Perf perf;
+  int cacheTag[TIMING_MAX_LINES];
+  unsigned long outputLen;
+} Record;
+
+/**
+* Fold bytes into an FNV-1a hash.
+* @param hash running hash
+* @param data bytes
+* @param len number of bytes
+* @return updated hash
+*/
+static unsigned long long fnv(unsigned long long hash, const void *data, size_t len) {
+	const unsigned char *p = data;
+	while (len-- > 0) {
+		hash ^= *p++;
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+* Open (creating if needed) a cache directory.
+* @param cache result cache to set up
+* @param dir directory holding the results
+* @return LC3_OK or LC3_ERR_FILE
+*/
+int lc3_cache_open(ResultCache *cache, const char *dir) {
+	memset(cache, 0, sizeof(ResultCache));
+	if (strlen(dir) + 32 > CACHE_PATH_SIZE) return LC3_ERR_FILE;
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST) return LC3_ERR_FILE;
+	strcpy(cache->dir, dir);
+	return LC3_OK;
+}
+
+/**
+* Hash everything that decides the outcome of a run.
+* @param lc LC class object, loaded and not yet run
+* @param input whole input stream
+* @param inputLen input length
+* @param budget instruction budget, 0 for none
+* @return cache key
+*/
+unsigned long long lc3_cache_key(const LC *lc, const char *input, size_t inputLen, unsigned long budget) {
+	unsigned long long hash = FNV_OFFSET;
+	hash = fnv(hash, LC3_VERSION, strlen(LC3_VERSION));
+	hash = fnv(hash, lc->memory, sizeof(lc->memory));
+	hash = fnv(hash, &lc->cpus, sizeof(lc->cpus));
+	hash = fnv(hash, &lc->timing, sizeof(lc->timing));
+	hash = fnv(hash, &lc->instructions, sizeof(lc->instructions));
+	hash = fnv(hash, &lc->perf, sizeof(lc->perf));
+	hash = fnv(hash, lc->cacheTag, sizeof(lc->cacheTag));
+	hash = fnv(hash, &budget, sizeof(budget));
+	hash = fnv(hash, &inputLen, sizeof(inputLen));
+	return fnv(hash, input, inputLen);
+}
+
+/**
+* Copy the starting point of a run into a key.
+* @param key key to fill
+* @param lc LC class object, loaded and not yet run
+* @param inputLen input length
+* @param budget instruction budget, 0 for none
+*/
+static void setKey(Key *key, const LC *lc, size_t inputLen, unsigned long budget) {
+	memset(key, 0, sizeof(Key));
+	memcpy(key->memory, lc->memory, sizeof(key->memory));
+	key->cpus = lc->cpus;
+	key->timing = lc->timing;
+	key->instructions = lc->instructions;
+	key->perf = lc->perf;
+	memcpy(key->cacheTag, lc->cacheTag, sizeof(key->cacheTag));
+	key->budget = budget;
+	key->inputLen = inputLen;
+}
+
+/**
+* GETC callback: next character of the recorded input.
+* @param user stream
+* @return character, or LC3_NO_INPUT at the end of the input
+*/
+static int streamRead(void *user) {
+	Stream *s = user;
+	if (s->pos == s->inputLen) return LC3_NO_INPUT;
+	return (unsigned char) s->input[s->pos++];
+}
+
+/**
+* OUT/PUTS callback: append to the result's output.
+* @param user stream
+* @param c character
+*/
+static void streamWrite(void *user, char c) {
+	Stream *s = user;
+	Result *r = s->result;
+	if (r->outputLen == s->outCap) {
+		size_t cap = s->outCap ? s->outCap * 2 : 256;
+		char *out = realloc(r->output, cap);
+		if (out == NULL) return;
+		r->output = out;
+		s->outCap = cap;
+	}
+	r->output[r->outputLen++] = c;
+}
+
+/**
+* Compare the stored input of a record with the input of this run.
+* @param file positioned after the record
+* @param input whole input stream
+* @param inputLen input length
+* @return 1 if equal
+*/
+static int sameInput(FILE *file, const char *input, size_t inputLen) {
+	char chunk[BUFSIZ];
+	size_t done, n;
+
+	for (done = 0; done < inputLen; done += n) {
+		n = inputLen - done < sizeof(chunk) ? inputLen - done : sizeof(chunk);
+		if (fread(chunk, 1, n, file) != n || memcmp(chunk, input + done, n) != 0) return 0;
+	}
+	return 1;
+}
+
+/**
+* Read a stored result, if it was recorded from the same starting point.
+* The file name is only a hash, so the key material is compared in full.
+* @param path result file
+* @param key starting point of this run
+* @param input whole input stream
+* @param result result to fill
+* @param cacheTag filled with the final cache tags
+* @return 1 on a hit, 0 if missing, unreadable or recorded from another run
+*/
+static int readResult(const char *path, const Key *key, const char *input, Result *result,
+		int *cacheTag) {
+	Record rec;
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return 0;
+
+	int ok = fread(&rec, sizeof(rec), 1, file) == 1
+		&& memcmp(rec.magic, CACHE_MAGIC, sizeof(rec.magic)) == 0
+		&& strncmp(rec.version, LC3_VERSION, sizeof(rec.version)) == 0
+		&& memcmp(&rec.key, key, sizeof(Key)) == 0
+		&& sameInput(file, input, key->inputLen);
+	if (ok) {
+		result->output = malloc(rec.outputLen + 1);
+		ok = result->output != NULL
+			&& fread(result->output, 1, rec.outputLen, file) == rec.outputLen;
+	}
+	fclose(file);
+	if (!ok) {
+		free(result->output);
+		result->output = NULL;
+		return 0;
+	}
+
+	result->status = rec.status;
+	result->cpus = rec.cpus;
+	memcpy(result->memory, rec.memory, sizeof(rec.memory));
+	result->instructions = rec.instructions;
+	result->perf = rec.perf;
+	result->outputLen = rec.outputLen;
+	memcpy(cacheTag, rec.cacheTag, sizeof(rec.cacheTag));
+	return 1;
+}
+
+/**
+* Store a result, writing a temporary file first so readers never see
+* half a record.
+* @param path result file
+* @param key starting point of the run
+* @param input whole input stream
+* @param result result to store
+* @param cacheTag final cache tags
+*/
+static void writeResult(const char *path, const Key *key, const char *input, const Result *result,
+		const int *cacheTag) {
+	char tmp[TEMP_PATH_SIZE];
+	Record rec;
+
+	memset(&rec, 0, sizeof(rec));
+	memcpy(rec.magic, CACHE_MAGIC, sizeof(rec.magic));
+	strncpy(rec.version, LC3_VERSION, sizeof(rec.version));
+	rec.key = *key;
+	rec.status = result->status;
+	rec.cpus = result->cpus;
+	memcpy(rec.memory, result->memory, sizeof(rec.memory));
+	rec.instructions = result->instructions;
+	rec.perf = result->perf;
+	memcpy(rec.cacheTag, cacheTag, sizeof(rec.cacheTag));
+	rec.outputLen = result->outputLen;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long) getpid()) >= (int) sizeof(tmp)) return;
+	FILE *file = fopen(tmp, "wb");
+	if (file == NULL) return;
+	int ok = fwrite(&rec, sizeof(rec), 1, file) == 1
+		&& fwrite(input, 1, key->inputLen, file) == key->inputLen
+		&& fwrite(result->output, 1, result->outputLen, file) == result->outputLen;
+	if (fclose(file) == 0 && ok) rename(tmp, path);
+	else remove(tmp);
+}
+
+/**
+* Count a hit or miss here and in the directory's shared stats file.
+* @param cache result cache
+* @param hit 1 for a hit
+*/
+static void countLookup(ResultCache *cache, int hit) {
+	char path[CACHE_PATH_SIZE + 8];
+	unsigned long hits = 0, misses = 0;
+
+	if (hit) cache->hits++;
+	else cache->misses++;
+
+	snprintf(path, sizeof(path), "%s/stats", cache->dir);
+	int fd = open(path, O_RDWR | O_CREAT, 0666);
+	if (fd < 0) return;
+	flock(fd, LOCK_EX);
+
+	FILE *file = fdopen(fd, "r+");
+	if (file == NULL) {
+		close(fd);
+		return;
+	}
+	if (fscanf(file, "hits %lu misses %lu", &hits, &misses) != 2) hits = misses = 0;
+	if (hit) hits++;
+	else misses++;
+	rewind(file);
+	fprintf(file, "hits %lu misses %lu\n", hits, misses);
+	fflush(file);
+	cache->totalHits = hits;
+	cache->totalMisses = misses;
+	fclose(file); // also releases the lock
+}
+
+/**
+* Run a machine on a fixed input, recording its output and final state.
+* @param lc LC class object, loaded and not yet run
+* @param input whole input stream
+* @param inputLen input length
+* @param budget instruction budget, 0 for none
+* @param result filled with the final state
+*/
+static void record(LC *lc, const char *input, size_t inputLen, unsigned long budget, Result *result) {
+	Stream stream = { input, inputLen, 0, result, 0 };
+	LC3_Callbacks saved = lc->io;
+	LC3_Callbacks io = { streamRead, streamWrite, saved.trap, &stream };
+	lc3_set_callbacks(lc, &io);
+	result->status = budget ? lc3_run_for(lc, budget) : lc3_run(lc);
+	lc3_set_callbacks(lc, &saved);
+
+	result->cpus = lc->cpus;
+	memcpy(result->memory, lc->memory, sizeof(lc->memory));
+	result->instructions = lc->instructions;
+	result->perf = lc->perf;
+}
+
+/**
+* Run a loaded machine to completion on a fixed input, or replay the stored
+* result of an identical earlier run. Either way the machine ends in the
+* final state and result holds it along with the output.
+* A machine with a trap callback installed is always run, as the cache
+* cannot tell what the callback does.
+* @param cache result cache
+* @param lc LC class object, loaded and not yet run
+* @param input whole input stream
+* @param inputLen input length
+* @param budget instruction budget, 0 for none
+* @param result filled with the final state; free with lc3_cache_free_result
+* @return the LC3_* status the run ended with
+*/
+int lc3_cache_run(ResultCache *cache, LC *lc, const char *input, size_t inputLen,
+		unsigned long budget, Result *result) {
+	char path[RESULT_PATH_SIZE];
+	Key key;
+
+	memset(result, 0, sizeof(Result));
+	if (lc->io.trap != NULL) {
+		cache->bypassed++;
+		record(lc, input, inputLen, budget, result);
+		return result->status;
+	}
+
+	setKey(&key, lc, inputLen, budget);
+	snprintf(path, sizeof(path), "%s/%016llx.lc3r", cache->dir,
+		lc3_cache_key(lc, input, inputLen, budget));
+
+	int hit = readResult(path, &key, input, result, lc->cacheTag);
+	countLookup(cache, hit);
+
+	if (hit) {
+		lc->cpus = result->cpus;
+		memcpy(lc->memory, result->memory, sizeof(lc->memory));
+		lc3_invalidate_all(lc);
+		lc->instructions = result->instructions;
+		lc->perf = result->perf; // readResult restored the cache tags
+		return result->status;
+	}
+
+	record(lc, input, inputLen, budget, result);
+	writeResult(path, &key, input, result, lc->cacheTag);
+	return result->status;
+}
+
+/**
+* Release the output held by a result.
+* @param result result
+*/
+void lc3_cache_free_result(Result *result) {
+	free(result->output);
+	result->output = NULL;
+	result->outputLen = 0;
+}
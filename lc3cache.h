@@ -0,0 +1,57 @@
+#ifndef LC3CACHE_H
+#define LC3CACHE_H
+
+/**
+* Content-addressed cache of headless run results.
+* A run is keyed by a hash of the simulator version, the loaded machine
+* (memory, CPU, timing model, counters and cache), the instruction budget
+* and the whole input stream. The record stores that starting point too,
+* and a lookup only hits when it matches in full. On a hit the stored final
+* state, cache tags included, and output are returned without executing,
+* so the machine can be resumed as if it had run. Machines with a trap
+* callback are never cached. Results live in one file per key in a
+* directory, next to a "stats" file with the hit/miss totals of every run.
+*/
+
+#include <stddef.h>
+#include "lc3core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CACHE_MAGIC "LC3T" // records carry their key and cache tags
+#define CACHE_PATH_SIZE 512
+
+/* Final state of a run.*/
+typedef struct result_s {
+  int status;
+  LC3_CPU cpus;
+  LC3_Word memory[LC3_MEM_SIZE];
+  unsigned long instructions;
+  LC3_Perf perf;
+  char *output;
+  size_t outputLen;
+} Result;
+
+/* Result cache class.*/
+typedef struct result_cache_s {
+  char dir[CACHE_PATH_SIZE];
+  unsigned long hits, misses;           // this process
+  unsigned long bypassed;               // runs not cached, see lc3_cache_run
+  unsigned long totalHits, totalMisses; // all runs sharing the directory
+} ResultCache;
+
+
+
+/** Functions Declarations.*/
+int lc3_cache_open(ResultCache *, const char *);
+unsigned long long lc3_cache_key(const LC3 *, const char *, size_t, unsigned long);
+int lc3_cache_run(ResultCache *, LC3 *, const char *, size_t, unsigned long, Result *);
+void lc3_cache_free_result(Result *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
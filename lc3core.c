@@ -0,0 +1,786 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "lc3internal.h"
+
+/* Warm-up, measured, at least one skipped and a final real iteration.*/
+#define SKIP_MIN_ITERATIONS 4
+
+static void initialize(LC *);
+static void resetCounters(LC *);
+static int debug_monitor(LC *, int);
+static void invalidateDecoded(LC *, Register);
+static void invalidateAllDecoded(LC *);
+static unsigned long skipLoop(LC *, Register, unsigned long);
+
+/* One cycle per micro-state, uncached memory.*/
+static const Timing defaultTiming = {
+	{ 1, 1, 1, 1, 1, 1 }, DEFAULT_MEM_LATENCY, 0, 1, 1
+};
+
+/**
+* Create a new LC simulator with cleared registers and memory.
+* @return LC class object, or NULL when out of memory
+*/
+LC * lc3_create(void) {
+	LC *lc = calloc(1, sizeof(LC));
+	if (lc != NULL) {
+		initialize(lc);
+		lc3_set_timing(lc, &defaultTiming);
+	}
+	return lc;
+}
+
+/**
+* Release an LC simulator.
+* @param lc LC class object
+*/
+void lc3_destroy(LC *lc) {
+	free(lc);
+}
+
+/**
+* Load memory's data from a text file and restart the counters.
+* @param lc LC class object
+* @param fileName hex file with one word per line
+* @return LC3_OK or LC3_ERR_FILE
+*/
+int lc3_load(LC *lc, const char * fileName) {
+
+	FILE *file = fopen(fileName, "r");
+	if (file == NULL) return LC3_ERR_FILE;
+
+	char hex[NO_OF_REGISTERS - 1];
+
+	int i = 0;
+
+	while(i < MEM_SIZE && fscanf(file, "%6s", hex) != EOF) {
+		lc->memory[i++] = (Register) strtol(hex, NULL, HEX_BITS);
+	}
+	invalidateAllDecoded(lc);
+	resetCounters(lc);
+
+	fclose(file);
+	return LC3_OK;
+}
+
+/**
+* Run until a halt instruction, a GETC with no input, or an error.
+* @param lc LC class object
+* @return LC3_HALTED, LC3_BLOCKED or an LC3_ERR_* code
+*/
+int lc3_run(LC *lc) {
+	return debug_monitor(lc, RUN);
+}
+
+/**
+* Run for at most a budget of instructions, e.g. one scheduler time slice.
+* Side-effect-free loops are fast-forwarded, see skipLoop.
+* @param lc LC class object
+* @param budget maximum number of instructions to execute
+* @return LC3_OK when the budget ran out, otherwise as lc3_run
+*/
+int lc3_run_for(LC *lc, unsigned long budget) {
+	int status = LC3_OK;
+	while (budget > 0 && status == LC3_OK) {
+		Register pc = lc->cpus.PC;
+		status = debug_monitor(lc, STEP);
+		budget--;
+		// a taken backward branch may close a loop that can be skipped
+		if (status == LC3_OK && lc->cpus.PC <= pc) {
+			budget -= skipLoop(lc, pc, budget);
+		}
+	}
+	return status;
+}
+
+/**
+* Execute a single instruction.
+* @param lc LC class object
+* @return LC3_OK, LC3_HALTED, LC3_BLOCKED or an LC3_ERR_* code
+*/
+int lc3_step(LC *lc) {
+	return debug_monitor(lc, STEP);
+}
+
+/**
+* Install the host's console and trap callbacks.
+* @param lc LC class object
+* @param callbacks callbacks to copy, or NULL to go back to stdin/stdout
+*/
+void lc3_set_callbacks(LC *lc, const LC3_Callbacks *callbacks) {
+	if (callbacks != NULL) lc->io = *callbacks;
+	else {
+		lc->io.readChar = NULL;
+		lc->io.writeChar = NULL;
+		lc->io.trap = NULL;
+		lc->io.user = NULL;
+	}
+}
+
+/**
+* Direct access to the register file, R0 to R7.
+* @param lc LC class object
+* @return the machine's own registers, not a copy
+*/
+Register * lc3_registers(LC *lc) {
+	return lc->cpus.reg_file;
+}
+
+/**
+* Direct access to memory. Call lc3_invalidate() or lc3_invalidate_all()
+* after writing through it so the decoded-instruction cache sees the change.
+* @param lc LC class object
+* @return the machine's own MEM_SIZE words, not a copy
+*/
+Register * lc3_memory(LC *lc) {
+	return lc->memory;
+}
+
+/**
+* Tell the machine a word written through lc3_memory() changed, so an
+* instruction decoded from it is decoded again.
+* @param lc LC class object
+* @param address memory address that was written
+* @return LC3_OK or LC3_ERR_ADDRESS
+*/
+int lc3_invalidate(LC *lc, Register address) {
+	if (address >= MEM_SIZE) return LC3_ERR_ADDRESS;
+	invalidateDecoded(lc, address);
+	return LC3_OK;
+}
+
+/**
+* Tell the machine any word written through lc3_memory() may have changed.
+* @param lc LC class object
+*/
+void lc3_invalidate_all(LC *lc) {
+	invalidateAllDecoded(lc);
+}
+
+/**
+* Direct access to the CPU (PC, IR, condition codes and latches).
+* @param lc LC class object
+* @return the machine's own CPU
+*/
+CPU_s * lc3_cpu(LC *lc) {
+	return &lc->cpus;
+}
+
+/**
+* Number of instructions retired since the program was loaded or the
+* timing model was set.
+* @param lc LC class object
+* @return instruction count
+*/
+unsigned long lc3_instructions(const LC *lc) {
+	return lc->instructions;
+}
+
+/**
+* Performance counters, see lc3_cpi for averages.
+* @param lc LC class object
+* @return the machine's own counters
+*/
+const Perf * lc3_perf(const LC *lc) {
+	return &lc->perf;
+}
+
+/**
+* Clear the instruction count, the performance counters and the cache, so
+* counting starts over from the current state.
+* @param lc LC class object
+*/
+static void resetCounters(LC *lc) {
+	int i;
+	lc->instructions = 0;
+	lc->perf = (Perf) { 0 };
+	for (i = 0; i < TIMING_MAX_LINES; i++) {
+		lc->cacheTag[i] = -1;
+	}
+}
+
+/**
+* Replace the timing model and restart the counters.
+* @param lc LC class object
+* @param timing cycles per phase and memory/cache parameters
+*/
+void lc3_set_timing(LC *lc, const Timing *timing) {
+	lc->timing = *timing;
+	if (lc->timing.cacheLines > TIMING_MAX_LINES) lc->timing.cacheLines = TIMING_MAX_LINES;
+	if (lc->timing.lineWords == 0) lc->timing.lineWords = 1;
+	resetCounters(lc);
+}
+
+/**
+* Average cycles per instruction.
+* @param lc LC class object
+* @param opcode one opcode, or ALL_OPCODES
+* @return CPI, 0 when nothing has retired or opcode is not 0..15
+*/
+double lc3_cpi(const LC *lc, int opcode) {
+	if (opcode == ALL_OPCODES) {
+		return lc->instructions ? (double) lc->perf.cycles / lc->instructions : 0;
+	}
+	if (opcode < 0 || opcode >= NO_OF_OPCODES) return 0;
+	unsigned long count = lc->perf.opcodeCount[opcode];
+	return count ? (double) lc->perf.opcodeCycles[opcode] / count : 0;
+}
+
+/**
+* Describe a status code.
+* @param status LC3_* status code
+* @return readable message
+*/
+const char * lc3_strerror(int status) {
+	switch (status) {
+		case LC3_OK: return "OK";
+		case LC3_HALTED: return "Halted";
+		case LC3_BLOCKED: return "Waiting for input";
+		case LC3_ERR_NOMEM: return "Out of memory";
+		case LC3_ERR_FILE: return "No such File or Directory";
+		case LC3_ERR_ADDRESS: return "Memory address out of range";
+		case LC3_ERR_TRAP: return "Unknown trap vector";
+	}
+	return "Unknown error";
+}
+
+/* Fields of the IR, one per ISA_FIELD in lc3isa.def.*/
+enum {
+#define ISA_FIELD(field, lsb, width, isSigned) FIELD_##field,
+#include "lc3isa.def"
+	NO_OF_FIELDS
+};
+
+/* Operand layouts for the disassembler.*/
+enum { FMT_NONE, FMT_RRR, FMT_RRI, FMT_RR, FMT_R_OFFSET9, FMT_RR_OFFSET6,
+	FMT_BR, FMT_OFFSET11, FMT_BASER, FMT_TRAP };
+
+/* One entry per instruction variant in lc3isa.def.*/
+enum {
+#define ISA(variant, opcode, select, field, phases, haltPhases, mnemonic, format, semantics) \
+	VARIANT_##variant,
+#include "lc3isa.def"
+	NO_OF_VARIANTS
+};
+
+/* Where a field sits in the IR: (IR >> lsb) & mask, then sign-extended from sign.*/
+typedef struct field_s {
+  unsigned char lsb;
+  Register mask, sign; // sign is 0 for an unsigned field
+} Field;
+
+static const Field fields[NO_OF_FIELDS] = {
+#define ISA_FIELD(field, lsb, width, isSigned) \
+	{ lsb, (1 << (width)) - 1, ((isSigned) << (width)) >> 1 },
+#include "lc3isa.def"
+};
+
+/* Static description of a variant.*/
+typedef struct variant_s {
+  unsigned char opcode, field, phases, haltPhases, format;
+  const char *mnemonic;
+} Variant;
+
+static const Variant variants[NO_OF_VARIANTS] = {
+#define ISA(variant, opcode, select, field, phases, haltPhases, mnemonic, format, semantics) \
+	{ opcode, FIELD_##field, phases, haltPhases, format, mnemonic },
+#include "lc3isa.def"
+};
+
+/* Variant for each opcode and value of its select bit.*/
+static const unsigned char variantOf[NO_OF_OPCODES][2] = {
+#define ISA(variant, opcode, select, field, phases, haltPhases, mnemonic, format, semantics) \
+	[opcode][select] = VARIANT_##variant,
+#include "lc3isa.def"
+};
+
+static const unsigned char selectBitOf[NO_OF_OPCODES] = {
+#define ISA_OPCODE(opcode, code, selectBit, name) [opcode] = selectBit,
+#include "lc3isa.def"
+};
+
+static const char * const opcodeNames[NO_OF_OPCODES] = {
+#define ISA_OPCODE(opcode, code, selectBit, name) [opcode] = name,
+#include "lc3isa.def"
+};
+
+/**
+* Extract a field of an IR, sign-extending signed fields.
+* @param theIR instruction register
+* @param field FIELD_* from lc3isa.def
+* @return field value
+*/
+static Register fieldOf(Register theIR, int field) {
+	const Field *f = &fields[field];
+	return (Register) ((((theIR >> f->lsb) & f->mask) ^ f->sign) - f->sign);
+}
+
+/**
+* Decode an instruction into its fields once, so loops do not re-decode the IR.
+* The variant is picked by table lookup on the opcode's select bit.
+* @param theIR instruction register
+* @param d decoded instruction to fill
+*/
+static void decode(Register theIR, Decoded *d) {
+	d->opcode = fieldOf(theIR, FIELD_OPCODE);
+	d->variant = variantOf[d->opcode][(theIR >> selectBitOf[d->opcode]) & 0x0001];
+	d->Dr = fieldOf(theIR, FIELD_DR);
+	d->Sr1 = fieldOf(theIR, FIELD_SR1);
+	d->Sr2 = fieldOf(theIR, FIELD_SR2);
+	d->n = fieldOf(theIR, FIELD_N);
+	d->z = fieldOf(theIR, FIELD_Z);
+	d->p = fieldOf(theIR, FIELD_P);
+	d->SEXT = fieldOf(theIR, variants[d->variant].field);
+	d->valid = 1;
+}
+
+/**
+* Get the decoded instruction at a memory address, decoding it on first use.
+* Entries on a page that has been written since are thrown away first.
+* @param lc LC class object
+* @param address memory address of the instruction
+* @return decoded instruction
+*/
+static Decoded * getDecoded(LC *lc, Register address) {
+	int page = address >> DECODE_PAGE_BITS;
+	unsigned int bit = 1u << (page % BITMAP_WORD_BITS);
+	unsigned int *word = &lc->dirtyPages[page / BITMAP_WORD_BITS];
+
+	if (*word & bit) {
+		int first = page << DECODE_PAGE_BITS, i;
+		for (i = first; i < first + (1 << DECODE_PAGE_BITS); i++) {
+			lc->decoded[i].valid = 0;
+		}
+		*word &= ~bit;
+	}
+
+	Decoded *d = &lc->decoded[address];
+	if (!d->valid) decode(lc->memory[address], d);
+	return d;
+}
+
+/**
+* Mark the page holding a memory address as dirty after a store.
+* @param lc LC class object
+* @param address memory address that was written
+*/
+static void invalidateDecoded(LC *lc, Register address) {
+	int page = address >> DECODE_PAGE_BITS;
+	lc->dirtyPages[page / BITMAP_WORD_BITS] |= 1u << (page % BITMAP_WORD_BITS);
+}
+
+/**
+* Mark every page as dirty, e.g. after loading a new program.
+* @param lc LC class object
+*/
+static void invalidateAllDecoded(LC *lc) {
+	int i;
+	for (i = 0; i < DIRTY_WORDS; i++) {
+		lc->dirtyPages[i] = ~0u;
+	}
+}
+
+/**
+* Initialize LC simulator.
+* @param lc LC class object
+*/
+static void initialize(LC *lc) {
+	lc->start_address = STARTING_ADDRESS; //intialize default starting address
+	lc->cpus.PC = 0;
+	lc->cpus.A = 0;
+	lc->cpus.B = 0;
+	lc->cpus.MDR = 0;
+	lc->cpus.MAR = 0;
+	lc->cpus.IR = 0;
+	lc->cpus.n = 0;
+    lc->cpus.z = 0;
+    lc->cpus.p = 0;
+	int i;
+	for(i = 0; i < NO_OF_REGISTERS; i++) {
+		lc->cpus.reg_file[i] = 0;
+	}
+	for(i = 0; i < MEM_SIZE; i++) {
+		lc->decoded[i].valid = 0;
+	}
+	for(i = 0; i < DIRTY_WORDS; i++) {
+		lc->dirtyPages[i] = 0;
+	}
+	resetCounters(lc);
+}
+
+/**
+* Trap 0x21 implementation for printing a single character.
+* @param lc class object
+* @return character in R0 register
+*/
+static char out(LC * lc) {
+  return ((lc->cpus.reg_file[0] & 0x00FF));
+}
+
+/**
+* Send one character to the host's console.
+* @param lc LC class object
+* @param c character
+*/
+static void writeChar(LC *lc, char c) {
+	if (lc->io.writeChar != NULL) lc->io.writeChar(lc->io.user, c);
+	else putchar(c);
+}
+
+/**
+* Serve a TRAP, giving the host's trap callback the first chance.
+* @param lc LC class object
+* @param vector trap vector, bits [7:0] of the IR
+* @return LC3_OK, LC3_HALTED, LC3_BLOCKED or an LC3_ERR_* code
+*/
+static int serveTrap(LC *lc, int vector) {
+	if (lc->io.trap != NULL) {
+		int status = lc->io.trap(lc->io.user, lc, vector);
+		if (status != LC3_TRAP_UNHANDLED) return status;
+	}
+
+	switch (vector) {
+		case TRAP_GETC: {
+			// R0 <= next character from the keyboard
+			int c = lc->io.readChar != NULL ? lc->io.readChar(lc->io.user) : getchar();
+			if (c < 0) return LC3_BLOCKED;
+			lc->cpus.reg_file[0] = (Register) (c & 0x00FF);
+			return LC3_OK;
+		}
+		case TRAP_OUT:
+			// write R0[7:0] to the monitor
+			writeChar(lc, out(lc));
+			return LC3_OK;
+		case TRAP_PUTS: {
+			// write the zero terminated string starting at Mem[R0]
+			Register address = lc->cpus.reg_file[0];
+			for (;;) {
+				if (address >= MEM_SIZE) return LC3_ERR_ADDRESS;
+				if (lc->memory[address] == 0) break;
+				writeChar(lc, (char) (lc->memory[address++] & 0x00FF));
+			}
+			return LC3_OK;
+		}
+		case TRAP_HALT:
+			return LC3_HALTED;
+	}
+	return LC3_ERR_TRAP;
+}
+
+/**
+* Trap counter of a vector.
+* @param vector trap vector
+* @return index into Perf.trapCount
+*/
+int lc3_trap_slot(int vector) {
+	switch (vector) {
+		case TRAP_GETC: return 0;
+		case TRAP_OUT: return 1;
+		case TRAP_PUTS: return 2;
+		case TRAP_HALT: return 3;
+	}
+	return TRAP_OTHER;
+}
+
+/**
+* Execute a TRAP and count it, unless it has to wait for input.
+* @param lc LC class object
+* @param vector trap vector, bits [7:0] of the IR
+* @return LC3_OK, LC3_HALTED, LC3_BLOCKED or an LC3_ERR_* code
+*/
+static int trap(LC *lc, int vector) {
+	int status = serveTrap(lc, vector);
+	if (status != LC3_BLOCKED) lc->perf.trapCount[lc3_trap_slot(vector)]++;
+	return status;
+}
+
+/* Cycles and memory events of the instruction in flight, counted when it retires.*/
+typedef struct pending_s {
+  unsigned long cycles; // memory cycles so far, then all of its cycles
+  unsigned long fetchStalls, loadStalls, storeStalls;
+  unsigned long cacheHits, cacheMisses;
+} Pending;
+
+/**
+* Charge one memory access through the (optional) cache model.
+* @param lc LC class object
+* @param address memory address on the MAR
+* @param pending instruction in flight, for its cache hits and misses
+* @return cycles the access takes
+*/
+static unsigned int memoryAccess(LC *lc, Register address, Pending *pending) {
+	if (lc->timing.cacheLines == 0) return lc->timing.memLatency;
+
+	int block = address / lc->timing.lineWords;
+	int line = block % lc->timing.cacheLines;
+	if (lc->cacheTag[line] == block) {
+		pending->cacheHits++;
+		return lc->timing.hitLatency;
+	}
+	pending->cacheMisses++;
+	lc->cacheTag[line] = block;
+	return lc->timing.memLatency;
+}
+
+/**
+* Count a retired instruction with the cycles and memory events it took.
+* An instruction that faults or blocks never gets here, so its fetch is
+* not counted until it really runs.
+* @param lc LC class object
+* @param opcode opcode of the instruction
+* @param pending cycles spent in all of its phases and its memory events
+*/
+static void retire(LC *lc, int opcode, const Pending *pending) {
+	lc->instructions++;
+	lc->perf.cycles += pending->cycles;
+	lc->perf.opcodeCount[opcode]++;
+	lc->perf.opcodeCycles[opcode] += pending->cycles;
+	lc->perf.fetchStalls += pending->fetchStalls;
+	lc->perf.loadStalls += pending->loadStalls;
+	lc->perf.storeStalls += pending->storeStalls;
+	lc->perf.cacheHits += pending->cacheHits;
+	lc->perf.cacheMisses += pending->cacheMisses;
+}
+
+/**
+* Charge a memory access to the instruction in flight.
+* @param lc LC class object
+* @param address memory address on the MAR
+* @param pending instruction in flight
+* @param stalls its fetchStalls, loadStalls or storeStalls
+*/
+static void stallOn(LC *lc, Register address, Pending *pending, unsigned long *stalls) {
+	unsigned int stall = memoryAccess(lc, address, pending);
+	*stalls += stall;
+	pending->cycles += stall;
+}
+
+/* Shorthands for the semantics in lc3isa.def.*/
+#define CPU lc->cpus
+#define REG(n) lc->cpus.reg_file[n]
+#define WRITE_DR() \
+	REG(d->Dr) = CPU.R; \
+	CPU.MAR = d->Dr; \
+	CPU.MDR = CPU.R
+#define READ_MEM(address) \
+	CPU.MAR = (address); \
+	if (CPU.MAR >= MEM_SIZE) return LC3_ERR_ADDRESS; \
+	stallOn(lc, CPU.MAR, pending, &pending->loadStalls); \
+	CPU.R = lc->memory[CPU.MAR]
+#define WRITE_MEM(address, value) \
+	if ((address) >= MEM_SIZE) return LC3_ERR_ADDRESS; \
+	stallOn(lc, (address), pending, &pending->storeStalls); \
+	CPU.MAR = (address); \
+	CPU.MDR = (value); \
+	lc->memory[CPU.MAR] = CPU.MDR; \
+	invalidateDecoded(lc, CPU.MAR)
+
+/* One specialized handler per variant: EVAL_ADDR .. STORE of the instruction.*/
+#define ISA(variant, opcode, select, field, phases, haltPhases, mnemonic, format, semantics) \
+static inline int exec_##variant(LC *lc, const Decoded *d, Register pc, Pending *pending) { \
+	(void) lc; (void) d; (void) pc; (void) pending; \
+	semantics \
+	return LC3_OK; \
+}
+#include "lc3isa.def"
+
+#undef WRITE_MEM
+#undef READ_MEM
+#undef WRITE_DR
+#undef REG
+#undef CPU
+
+/**
+* Execute one instruction: FETCH and DECODE here, the rest in its handler.
+* @param lc LC class object
+* @return LC3_OK, LC3_HALTED, LC3_BLOCKED or an LC3_ERR_* code
+*/
+static int execute(LC *lc) {
+	int status, i;
+
+	// FETCH
+	if (lc->cpus.PC >= MEM_SIZE) return LC3_ERR_ADDRESS;
+	Register pc = lc->cpus.PC;
+	Pending pending = { 0, 0, 0, 0, 0, 0 };
+	stallOn(lc, pc, &pending, &pending.fetchStalls);
+	lc->cpus.IR = lc->memory[lc->cpus.PC++];
+
+	// DECODE, only the first time this address runs
+	const Decoded *d = getDecoded(lc, pc);
+
+	// EVAL_ADDR .. STORE
+	switch (d->variant) {
+#define ISA(variant, opcode, select, field, phases, haltPhases, mnemonic, format, semantics) \
+		case VARIANT_##variant: status = exec_##variant(lc, d, pc, &pending); break;
+#include "lc3isa.def"
+		default: status = LC3_OK;
+	}
+
+	if (status == LC3_OK || status == LC3_HALTED) {
+		const Variant *v = &variants[d->variant];
+		int phases = status == LC3_HALTED ? v->haltPhases : v->phases;
+		for (i = 0; i < phases; i++) {
+			pending.cycles += lc->timing.phase[i];
+		}
+		retire(lc, d->opcode, &pending);
+	} else if (status == LC3_BLOCKED) {
+		lc->cpus.PC = pc; // retry once input arrives
+	}
+	return status;
+}
+
+/**
+* Add the counters of an iteration to the perf counters several times.
+* @param perf perf counters
+* @param before counters at the start of the iteration
+* @param after counters at the end of the iteration
+* @param times number of iterations to add
+*/
+static void addPerf(Perf *perf, const Perf *before, const Perf *after, unsigned long times) {
+	int i;
+	perf->cycles += (after->cycles - before->cycles) * times;
+	for (i = 0; i < NO_OF_OPCODES; i++) {
+		perf->opcodeCount[i] += (after->opcodeCount[i] - before->opcodeCount[i]) * times;
+		perf->opcodeCycles[i] += (after->opcodeCycles[i] - before->opcodeCycles[i]) * times;
+	}
+	perf->fetchStalls += (after->fetchStalls - before->fetchStalls) * times;
+	perf->loadStalls += (after->loadStalls - before->loadStalls) * times;
+	perf->storeStalls += (after->storeStalls - before->storeStalls) * times;
+	perf->cacheHits += (after->cacheHits - before->cacheHits) * times;
+	perf->cacheMisses += (after->cacheMisses - before->cacheMisses) * times;
+	for (i = 0; i < NO_OF_TRAPS; i++) {
+		perf->trapCount[i] += (after->trapCount[i] - before->trapCount[i]) * times;
+	}
+}
+
+/**
+* Fast-forward a loop that was just closed by a taken backward branch.
+* Only side-effect-free loops are skipped: a body of NOPs and
+* ADD Rx, Rx, #imm counters, e.g. "BRnzp #-1" or "ADD R1, R1, #-1 / BRp".
+* Each iteration then adds the same amount to each register and, once the
+* fetches have warmed the cache model, the same amount to each counter.
+* One iteration is run to warm up and one to measure those amounts, the
+* bulk is applied in closed form, and the last whole iteration is left to
+* the caller so the latches end exactly as if every instruction had run.
+* @param lc LC class object, PC at the top of the loop
+* @param branch address of the backward branch
+* @param budget instructions left to run
+* @return instructions accounted for, at most budget
+*/
+static unsigned long skipLoop(LC *lc, Register branch, unsigned long budget) {
+	Register top = lc->cpus.PC, address, delta[NO_OF_REGISTERS];
+	const Decoded *d = getDecoded(lc, branch);
+	unsigned long length = branch - top + 1, done = 0, skipped;
+	Perf warm, measured;
+	int i, j;
+
+	if (d->variant != VARIANT_BR || !(d->n || d->z || d->p)) return 0;
+	if (budget / length < SKIP_MIN_ITERATIONS) return 0;
+	for (address = top; address < branch; address++) {
+		d = getDecoded(lc, address);
+		if (d->variant == VARIANT_BR && !(d->n || d->z || d->p)) continue;
+		if (d->variant == VARIANT_ADD_IMM && d->Dr == d->Sr1) continue;
+		return 0;
+	}
+
+	// warm up, then measure one iteration
+	for (i = 0; i < 2; i++) {
+		CPU_s before = lc->cpus;
+		Perf perf = lc->perf;
+		unsigned long n;
+		for (n = 0; n < length; n++, done++) {
+			if (debug_monitor(lc, STEP) != LC3_OK) return done; // not reached by these shapes
+		}
+		for (j = 0; j < NO_OF_REGISTERS; j++) {
+			delta[j] = lc->cpus.reg_file[j] - before.reg_file[j];
+		}
+		measured = lc->perf;
+		warm = perf;
+	}
+
+	skipped = budget / length - 3;
+	for (j = 0; j < NO_OF_REGISTERS; j++) {
+		lc->cpus.reg_file[j] += (Register) (delta[j] * skipped);
+	}
+	addPerf(&lc->perf, &warm, &measured, skipped);
+	lc->instructions += skipped * length;
+	return done + skipped * length;
+}
+
+/**
+* Execute the program
+* @param lc LC class object
+* @param option RUN until a halt, or STEP one instruction
+* @return LC3_OK after a step, LC3_HALTED, LC3_BLOCKED, or an LC3_ERR_* code
+*/
+static int debug_monitor(LC *lc, int option) {
+	int status;
+	do {
+		status = execute(lc);
+	} while (option == RUN && status == LC3_OK);
+	return status;
+}
+
+/**
+* Mnemonic of an opcode.
+* @param opcode opcode
+* @return mnemonic
+*/
+const char * lc3_opcode_name(int opcode) {
+	return opcodeNames[opcode & 0x000F];
+}
+
+/**
+* Disassemble an instruction.
+* @param theIR instruction register
+* @param text buffer for the assembly text
+* @param size size of the buffer
+* @return text
+*/
+char * lc3_disassemble(Register theIR, char *text, int size) {
+	Decoded d;
+	decode(theIR, &d);
+	const Variant *v = &variants[d.variant];
+
+	switch (v->format) {
+		case FMT_RRR:
+			snprintf(text, size, "%s R%d, R%d, R%d", v->mnemonic, d.Dr, d.Sr1, d.Sr2);
+			break;
+		case FMT_RRI:
+			snprintf(text, size, "%s R%d, R%d, #%d", v->mnemonic, d.Dr, d.Sr1, (short) d.SEXT);
+			break;
+		case FMT_RR:
+			snprintf(text, size, "%s R%d, R%d", v->mnemonic, d.Dr, d.Sr1);
+			break;
+		case FMT_R_OFFSET9:
+			snprintf(text, size, "%s R%d, #%d", v->mnemonic, d.Dr, (short) d.SEXT);
+			break;
+		case FMT_RR_OFFSET6:
+			snprintf(text, size, "%s R%d, R%d, #%d", v->mnemonic, d.Dr, d.Sr1, (short) d.SEXT);
+			break;
+		case FMT_BR:
+			if (!d.n && !d.z && !d.p) snprintf(text, size, "NOP");
+			else snprintf(text, size, "%s%s%s%s #%d", v->mnemonic, d.n ? "n" : "",
+				d.z ? "z" : "", d.p ? "p" : "", (short) d.SEXT);
+			break;
+		case FMT_OFFSET11:
+			snprintf(text, size, "%s #%d", v->mnemonic, (short) d.SEXT);
+			break;
+		case FMT_BASER:
+			if (d.opcode == JMP && d.SEXT == R7) snprintf(text, size, "RET");
+			else snprintf(text, size, "%s R%d", v->mnemonic, d.SEXT);
+			break;
+		case FMT_TRAP:
+			switch (d.SEXT) {
+				case TRAP_GETC: snprintf(text, size, "GETC"); break;
+				case TRAP_OUT: snprintf(text, size, "OUT"); break;
+				case TRAP_PUTS: snprintf(text, size, "PUTS"); break;
+				case TRAP_HALT: snprintf(text, size, "HALT"); break;
+				default: snprintf(text, size, "%s x%02X", v->mnemonic, d.SEXT);
+			}
+			break;
+		default:
+			snprintf(text, size, "%s", v->mnemonic);
+	}
+	return text;
+}
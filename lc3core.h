@@ -0,0 +1,118 @@
+#ifndef LC3CORE_H
+#define LC3CORE_H
+
+/**
+* LC-3 simulator core (liblc3).
+* Holds no global state: everything lives in the LC object, so several
+* machines can run side by side or on different threads. Functions report
+* problems through the LC3_* status codes and never exit the process.
+*
+* This is the public header of liblc3.a / liblc3.so and must not pull in
+* ncurses or termios. Console I/O and traps go through LC3_Callbacks.
+* Everything it defines is prefixed LC3_/lc3_; the machine layout lives in
+* the private lc3internal.h, so LC3 can grow without breaking hosts.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Major version is the soname of liblc3.so. Any change to what a program
+   computes or how it is counted bumps it, as cached results key on it.*/
+#define LC3_VERSION "3.2"
+
+#define LC3_OK 0
+#define LC3_HALTED 1
+#define LC3_BLOCKED 2 // GETC found no input, the TRAP re-executes on the next run
+#define LC3_TRAP_UNHANDLED 3 // returned by a trap callback to use the built-in trap
+#define LC3_ERR_NOMEM -1
+#define LC3_ERR_FILE -2
+#define LC3_ERR_ADDRESS -3
+#define LC3_ERR_TRAP -4
+
+#define LC3_NO_INPUT -1 // returned by readChar when no character is ready
+
+#define LC3_TRAP_GETC 0x20
+#define LC3_TRAP_OUT 0x21
+#define LC3_TRAP_PUTS 0x22
+#define LC3_TRAP_HALT 0x25
+
+#define LC3_MEM_SIZE 16
+#define LC3_NO_OF_REGISTERS 8
+#define LC3_NO_OF_OPCODES 16
+#define LC3_NO_OF_PHASES 6 // micro-states FETCH .. STORE
+#define LC3_ALL_OPCODES -1
+#define LC3_TIMING_MAX_LINES 64
+#define LC3_NO_OF_TRAPS 5 // trap counters: GETC, OUT, PUTS, HALT, any other vector
+#define LC3_TRAP_OTHER 4
+
+
+typedef unsigned short LC3_Word;
+
+
+
+/* Architectural registers and datapath latches.*/
+typedef struct lc3_cpu {
+  LC3_Word IR, PC, SEXT, MDR, MAR, A, B, R, n, z, p;
+  LC3_Word reg_file[LC3_NO_OF_REGISTERS];
+} LC3_CPU;
+
+/* Timing model: cycles charged per micro-state and per MAR/MDR memory access.*/
+typedef struct lc3_timing {
+  unsigned int phase[LC3_NO_OF_PHASES]; // cycles for FETCH .. STORE
+  unsigned int memLatency;  // cycles per memory access (a cache miss when modeled)
+  unsigned int cacheLines;  // direct-mapped cache lines, 0 = no cache, power of 2
+  unsigned int lineWords;   // words per cache line, power of 2
+  unsigned int hitLatency;  // cycles per cache hit
+} LC3_Timing;
+
+/* Performance counters, reset when a program is loaded or the timing model is set.*/
+typedef struct lc3_perf {
+  unsigned long cycles;
+  unsigned long opcodeCount[LC3_NO_OF_OPCODES];
+  unsigned long opcodeCycles[LC3_NO_OF_OPCODES];
+  unsigned long fetchStalls, loadStalls, storeStalls; // memory cycles by cause
+  unsigned long cacheHits, cacheMisses;
+  unsigned long trapCount[LC3_NO_OF_TRAPS]; // served traps, by lc3_trap_slot
+} LC3_Perf;
+
+/* Simulator, opaque: use the lc3_* functions.*/
+typedef struct lc LC3;
+
+/* Host callbacks. A NULL readChar/writeChar falls back to stdin/stdout.*/
+typedef struct lc3_callbacks {
+  int (*readChar)(void *user);              // next character, or LC3_NO_INPUT
+  void (*writeChar)(void *user, char c);
+  int (*trap)(void *user, LC3 *lc, int vector); // runs before the built-in traps
+  void *user;
+} LC3_Callbacks;
+
+
+
+/** Functions Declarations.*/
+LC3 * lc3_create(void);
+void lc3_destroy(LC3 *);
+int lc3_load(LC3 *, const char *);
+int lc3_run(LC3 *);
+int lc3_run_for(LC3 *, unsigned long);
+int lc3_step(LC3 *);
+const char * lc3_strerror(int);
+void lc3_set_callbacks(LC3 *, const LC3_Callbacks *);
+LC3_Word * lc3_registers(LC3 *);
+LC3_Word * lc3_memory(LC3 *);
+int lc3_invalidate(LC3 *, LC3_Word);
+void lc3_invalidate_all(LC3 *);
+LC3_CPU * lc3_cpu(LC3 *);
+unsigned long lc3_instructions(const LC3 *);
+const LC3_Perf * lc3_perf(const LC3 *);
+void lc3_set_timing(LC3 *, const LC3_Timing *);
+double lc3_cpi(const LC3 *, int);
+const char * lc3_opcode_name(int);
+char * lc3_disassemble(LC3_Word, char *, int);
+int lc3_trap_slot(int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
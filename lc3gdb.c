@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lc3gdb.h"
+#include "lc3internal.h"
+
+#define GDB_PACKET_SIZE 1024
+#define GDB_POLL 4096 // instructions between checks for a ^C from the client
+#define GDB_REGISTERS 10
+#define GDB_PC 8
+#define GDB_CC 9
+
+#define SIGINT_STOP 2
+#define SIGILL_STOP 4
+#define SIGTRAP_STOP 5
+#define SIGSEGV_STOP 11
+
+/* Debug session class.*/
+typedef struct gdb_stub {
+  LC *lc;
+  int fd;
+  int lastStop; // signal of the last stop, for "?"
+  StatsWriter *stats; // published while running and at each stop, or NULL
+  unsigned char breakpoint[MEM_SIZE];
+  char packet[GDB_PACKET_SIZE];
+  char reply[GDB_PACKET_SIZE];
+} GdbStub;
+
+static const char hexDigits[] = "0123456789abcdef";
+
+/**
+* Value of a hex digit.
+* @param c character
+* @return 0 to 15, or -1 if c is not a hex digit
+*/
+static int hexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/**
+* Value of two hex digits.
+* @param in hex digits, high nibble first
+* @return 0 to 255, or -1 if either is not a hex digit
+*/
+static int hexByte(const char *in) {
+	int high = hexValue(in[0]), low = hexValue(in[1]);
+	if (high < 0 || low < 0) return -1;
+	return high << 4 | low;
+}
+
+/**
+* Append a 16-bit register in target (little-endian) byte order.
+* @param out where to write 4 hex digits
+* @param value register value
+*/
+static void putWord(char *out, Register value) {
+	out[0] = hexDigits[(value >> 4) & 0xF];
+	out[1] = hexDigits[value & 0xF];
+	out[2] = hexDigits[(value >> 12) & 0xF];
+	out[3] = hexDigits[(value >> 8) & 0xF];
+}
+
+/**
+* Parse a 16-bit register in target (little-endian) byte order.
+* @param in 4 hex digits
+* @param value set to the register value
+* @return 1, or 0 if in holds a non-hex digit
+*/
+static int getWord(const char *in, Register *value) {
+	int low = hexByte(in), high = hexByte(in + 2);
+	if (low < 0 || high < 0) return 0;
+	*value = (Register) (high << 8 | low);
+	return 1;
+}
+
+/**
+* Check that a byte range lies inside the word-addressed memory.
+* @param addr first word
+* @param len number of bytes
+* @return 1 if every byte is in memory
+*/
+static int inMemory(unsigned long addr, unsigned long len) {
+	return addr < MEM_SIZE && len <= (MEM_SIZE - addr) * 2;
+}
+
+/**
+* Read a GDB register.
+* @param lc LC class object
+* @param n register number, see lc3gdb.h
+* @return value
+*/
+static Register getRegister(LC *lc, int n) {
+	if (n < NO_OF_REGISTERS) return lc->cpus.reg_file[n];
+	if (n == GDB_PC) return lc->cpus.PC;
+	return (Register) (lc->cpus.n << 2 | lc->cpus.z << 1 | lc->cpus.p);
+}
+
+/**
+* Write a GDB register.
+* @param lc LC class object
+* @param n register number, see lc3gdb.h
+* @param value new value
+*/
+static void setRegister(LC *lc, int n, Register value) {
+	if (n < NO_OF_REGISTERS) lc->cpus.reg_file[n] = value;
+	else if (n == GDB_PC) lc->cpus.PC = value;
+	else {
+		lc->cpus.n = (value >> 2) & 0x0001;
+		lc->cpus.z = (value >> 1) & 0x0001;
+		lc->cpus.p = value & 0x0001;
+	}
+}
+
+/**
+* Receive the next packet, acknowledging it.
+* @param g debug session
+* @return packet length, or -1 once the client is gone
+*/
+static int readPacket(GdbStub *g) {
+	char c;
+	int len;
+
+	for (;;) {
+		do { // skip acks and stray ^C between packets
+			if (read(g->fd, &c, 1) != 1) return -1;
+		} while (c != '$');
+
+		unsigned char sum = 0;
+		len = 0;
+		for (;;) {
+			if (read(g->fd, &c, 1) != 1) return -1;
+			if (c == '#') break;
+			if (len < GDB_PACKET_SIZE - 1) g->packet[len++] = c;
+			sum += (unsigned char) c;
+		}
+		g->packet[len] = '\0';
+
+		char check[2];
+		if (read(g->fd, check, 1) != 1 || read(g->fd, check + 1, 1) != 1) return -1;
+		if (hexByte(check) == sum) break;
+		if (write(g->fd, "-", 1) != 1) return -1; // ask for a resend
+	}
+	if (write(g->fd, "+", 1) != 1) return -1;
+	return len;
+}
+
+/**
+* Send a packet with its checksum.
+* @param g debug session
+* @param data packet body
+*/
+static void sendPacket(GdbStub *g, const char *data) {
+	char frame[GDB_PACKET_SIZE + 4];
+	unsigned char sum = 0;
+	int len = 0;
+
+	frame[len++] = '$';
+	while (*data != '\0' && len < GDB_PACKET_SIZE) {
+		sum += (unsigned char) *data;
+		frame[len++] = *data++;
+	}
+	frame[len++] = '#';
+	frame[len++] = hexDigits[sum >> 4];
+	frame[len++] = hexDigits[sum & 0xF];
+	if (write(g->fd, frame, len) < 0) return; // a lost client shows up on the next read
+}
+
+/**
+* Check, without blocking, whether the client sent a ^C.
+* @param g debug session
+* @return 1 if the program should stop
+*/
+static int interrupted(GdbStub *g) {
+	struct pollfd p = { g->fd, POLLIN, 0 };
+	char c;
+
+	if (poll(&p, 1, 0) <= 0) return 0;
+	if (recv(g->fd, &c, 1, MSG_PEEK) != 1) return 1; // client gone, stop
+	if (c != 0x03) return 0;
+	return read(g->fd, &c, 1) == 1;
+}
+
+/**
+* Step or continue, then build the stop reply.
+* @param g debug session
+* @param step 1 to execute a single instruction
+*/
+static void resume(GdbStub *g, int step) {
+	unsigned long n = 0;
+	int status, stop = SIGTRAP_STOP;
+
+	for (;;) {
+		status = lc3_step(g->lc);
+		if (status != LC3_OK || step) break;
+		if (g->lc->cpus.PC < MEM_SIZE && g->breakpoint[g->lc->cpus.PC]) break;
+		if (++n % GDB_POLL == 0) {
+			if (g->stats != NULL) lc3_stats_publish_lc(g->stats, g->lc, STATS_RUNNING);
+			if (interrupted(g)) {
+				stop = SIGINT_STOP;
+				break;
+			}
+		}
+	}
+	if (g->stats != NULL) lc3_stats_publish_lc(g->stats, g->lc, lc3_stats_state_of(status));
+
+	if (status == LC3_HALTED) {
+		strcpy(g->reply, "W00");
+		return;
+	}
+	if (status == LC3_ERR_ADDRESS) stop = SIGSEGV_STOP;
+	else if (status < 0) stop = SIGILL_STOP;
+	g->lastStop = stop;
+	snprintf(g->reply, GDB_PACKET_SIZE, "S%02x", stop);
+}
+
+/**
+* Parse "addr,len" from a packet.
+* @param p text after the command letter
+* @param addr parsed word address
+* @param len parsed byte count
+* @return pointer past the numbers
+*/
+static char * parseRange(char *p, unsigned long *addr, unsigned long *len) {
+	*addr = strtoul(p, &p, 16);
+	if (*p == ',') p++;
+	*len = strtoul(p, &p, 16);
+	return p;
+}
+
+/**
+* Handle "m addr,len": read memory, low byte of each word first.
+* @param g debug session
+*/
+static void readMemory(GdbStub *g) {
+	unsigned long addr, len, i;
+	parseRange(g->packet + 1, &addr, &len);
+
+	if (!inMemory(addr, len) || len * 2 >= GDB_PACKET_SIZE) {
+		strcpy(g->reply, "E01");
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		Register word = g->lc->memory[addr + i / 2];
+		int byte = i % 2 ? word >> 8 : word & 0x00FF;
+		g->reply[i * 2] = hexDigits[byte >> 4];
+		g->reply[i * 2 + 1] = hexDigits[byte & 0xF];
+	}
+	g->reply[len * 2] = '\0';
+}
+
+/**
+* Handle "M addr,len:data": write memory, low byte of each word first.
+* @param g debug session
+*/
+static void writeMemory(GdbStub *g) {
+	unsigned long addr, len, i;
+	char *data = parseRange(g->packet + 1, &addr, &len);
+
+	if (*data++ != ':' || !inMemory(addr, len) || strlen(data) < len * 2) {
+		strcpy(g->reply, "E01");
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		if (hexByte(data + i * 2) < 0) {
+			strcpy(g->reply, "E01");
+			return;
+		}
+	}
+	for (i = 0; i < len; i++) {
+		Register *word = &g->lc->memory[addr + i / 2];
+		int byte = hexByte(data + i * 2);
+		if (i % 2) *word = (*word & 0x00FF) | byte << 8;
+		else *word = (*word & 0xFF00) | byte;
+		lc3_invalidate(g->lc, addr + i / 2);
+	}
+	strcpy(g->reply, "OK");
+}
+
+/**
+* Handle "Z0,addr,kind" and "z0,addr,kind".
+* @param g debug session
+* @param set 1 to insert, 0 to remove
+*/
+static void breakpoint(GdbStub *g, int set) {
+	unsigned long addr, kind;
+
+	if (g->packet[1] != '0') { // only software breakpoints
+		g->reply[0] = '\0';
+		return;
+	}
+	if (g->packet[2] != ',') {
+		strcpy(g->reply, "E01");
+		return;
+	}
+	parseRange(g->packet + 3, &addr, &kind);
+	if (addr >= MEM_SIZE) {
+		strcpy(g->reply, "E01");
+		return;
+	}
+	g->breakpoint[addr] = set;
+	strcpy(g->reply, "OK");
+}
+
+/**
+* Handle one packet.
+* @param g debug session
+* @return 0 once the client detached or killed the program
+*/
+static int handlePacket(GdbStub *g) {
+	char *p = g->packet;
+	int i;
+
+	g->reply[0] = '\0';
+	switch (p[0]) {
+		case '?':
+			snprintf(g->reply, GDB_PACKET_SIZE, "S%02x", g->lastStop);
+			break;
+		case 'g':
+			for (i = 0; i < GDB_REGISTERS; i++) {
+				putWord(g->reply + i * 4, getRegister(g->lc, i));
+			}
+			g->reply[GDB_REGISTERS * 4] = '\0';
+			break;
+		case 'G': {
+			Register values[GDB_REGISTERS];
+			int ok = strlen(p + 1) >= GDB_REGISTERS * 4;
+			for (i = 0; ok && i < GDB_REGISTERS; i++) {
+				ok = getWord(p + 1 + i * 4, &values[i]);
+			}
+			if (!ok) {
+				strcpy(g->reply, "E01");
+				break;
+			}
+			for (i = 0; i < GDB_REGISTERS; i++) {
+				setRegister(g->lc, i, values[i]);
+			}
+			strcpy(g->reply, "OK");
+			break;
+		}
+		case 'p': {
+			unsigned long n = strtoul(p + 1, NULL, 16);
+			if (n >= GDB_REGISTERS) strcpy(g->reply, "E01");
+			else {
+				putWord(g->reply, getRegister(g->lc, (int) n));
+				g->reply[4] = '\0';
+			}
+			break;
+		}
+		case 'P': {
+			char *value;
+			Register word;
+			unsigned long n = strtoul(p + 1, &value, 16);
+			if (n >= GDB_REGISTERS || *value != '=' || strlen(value + 1) < 4
+					|| !getWord(value + 1, &word)) {
+				strcpy(g->reply, "E01");
+				break;
+			}
+			setRegister(g->lc, (int) n, word);
+			strcpy(g->reply, "OK");
+			break;
+		}
+		case 'm':
+			readMemory(g);
+			break;
+		case 'M':
+			writeMemory(g);
+			break;
+		case 'c':
+		case 's':
+			if (p[1] != '\0') g->lc->cpus.PC = (Register) strtoul(p + 1, NULL, 16);
+			resume(g, p[0] == 's');
+			break;
+		case 'Z':
+			breakpoint(g, 1);
+			break;
+		case 'z':
+			breakpoint(g, 0);
+			break;
+		case 'D':
+			sendPacket(g, "OK");
+			return 0;
+		case 'k':
+			return 0;
+		case 'H':
+			strcpy(g->reply, "OK");
+			break;
+		case 'q':
+			if (strncmp(p, "qSupported", 10) == 0) {
+				snprintf(g->reply, GDB_PACKET_SIZE, "PacketSize=%x", GDB_PACKET_SIZE);
+			} else if (strcmp(p, "qAttached") == 0) strcpy(g->reply, "1");
+			break;
+	}
+	sendPacket(g, g->reply);
+	return 1;
+}
+
+/**
+* Listen for a debugger on a local socket.
+* @param where TCP port on localhost, or a Unix socket path (contains '/')
+* @return listening socket, or -1
+*/
+int lc3_gdb_listen(const char *where) {
+	int fd;
+
+	if (strchr(where, '/') != NULL) {
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (strlen(where) >= sizeof(addr.sun_path)) return -1;
+		strcpy(addr.sun_path, where);
+		unlink(where);
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) return -1;
+		if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	struct sockaddr_in addr;
+	int one = 1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((unsigned short) atoi(where));
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+* Accept one debugger and serve it until it detaches, kills the program
+* or disconnects.
+* @param lc LC class object, loaded
+* @param listenFd socket from lc3_gdb_listen
+* @param stats where to publish live counters, or NULL
+* @return LC3_OK, or LC3_ERR_FILE if no debugger could connect
+*/
+int lc3_gdb_serve(LC *lc, int listenFd, StatsWriter *stats) {
+	GdbStub *g = calloc(1, sizeof(GdbStub));
+	if (g == NULL) return LC3_ERR_NOMEM;
+
+	g->lc = lc;
+	g->lastStop = SIGTRAP_STOP;
+	g->stats = stats;
+	g->fd = accept(listenFd, NULL, NULL);
+	if (g->fd < 0) {
+		free(g);
+		return LC3_ERR_FILE;
+	}
+
+	while (readPacket(g) >= 0 && handlePacket(g)) {
+	}
+
+	close(g->fd);
+	free(g);
+	return LC3_OK;
+}
@@ -0,0 +1,28 @@
+#ifndef LC3GDB_H
+#define LC3GDB_H
+
+/**
+* GDB remote serial protocol stub for a headless machine.
+* Registers are 16-bit little-endian, in the order R0..R7, PC, CC
+* (CC = N<<2 | Z<<1 | P). Memory is word addressed: "m addr,len" starts at
+* word addr and returns len bytes, low byte of each word first. Between
+* stops the program runs through lc3_step at full interpreter speed.
+* Supported: ? g G p P m M c s Z0 z0 D k qSupported qAttached.
+*/
+
+#include "lc3core.h"
+#include "lc3stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Functions Declarations.*/
+int lc3_gdb_listen(const char *);
+int lc3_gdb_serve(LC3 *, int, StatsWriter *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
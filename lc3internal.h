@@ -0,0 +1,92 @@
+#ifndef LC3INTERNAL_H
+#define LC3INTERNAL_H
+
+/**
+* Private layout of the LC-3 simulator, shared by the modules of liblc3 and
+* by the ncurses front end built from the same sources. Hosts linking
+* liblc3 only get lc3core.h, where LC3 is opaque.
+*/
+
+#include "lc3core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FETCH 0
+#define DECODE 1
+#define EVAL_ADDR 2
+#define FETCH_OP 3
+#define EXECUTE 4
+#define STORE 5
+
+/* Opcodes BR .. TRAP, the value of IR[15:12].*/
+enum {
+#define ISA_OPCODE(opcode, code, selectBit, name) opcode = code,
+#include "lc3isa.def"
+};
+
+#define RUN 2
+#define STEP 3
+
+#define TRAP_GETC LC3_TRAP_GETC
+#define TRAP_OUT LC3_TRAP_OUT
+#define TRAP_PUTS LC3_TRAP_PUTS
+#define TRAP_HALT LC3_TRAP_HALT
+
+#define R7 7
+#define HEX_BITS 16
+#define MEM_SIZE LC3_MEM_SIZE
+#define NO_OF_REGISTERS LC3_NO_OF_REGISTERS
+#define NZP 1
+#define STARTING_ADDRESS 0x3000
+
+#define NO_OF_OPCODES LC3_NO_OF_OPCODES
+#define NO_OF_PHASES LC3_NO_OF_PHASES
+#define ALL_OPCODES LC3_ALL_OPCODES
+#define TIMING_MAX_LINES LC3_TIMING_MAX_LINES
+#define DEFAULT_MEM_LATENCY 4
+#define NO_OF_TRAPS LC3_NO_OF_TRAPS
+#define TRAP_OTHER LC3_TRAP_OTHER
+
+#define DECODE_PAGE_BITS 2 // 4 words per page of the dirty bitmap
+#define DECODE_PAGES (MEM_SIZE >> DECODE_PAGE_BITS)
+#define BITMAP_WORD_BITS 32
+#define DIRTY_WORDS ((DECODE_PAGES + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+
+
+typedef LC3_Word Register;
+typedef LC3_CPU CPU_s;
+typedef LC3_Timing Timing;
+typedef LC3_Perf Perf;
+
+
+
+/* Decoded instruction class, filled lazily the first time an address is fetched.*/
+typedef struct decoded_s {
+  unsigned char valid;
+  unsigned char variant; // instruction variant in lc3isa.def, e.g. ADD_IMM
+  unsigned char opcode, Dr, Sr1, Sr2; // Sr1 doubles as BaseR
+  unsigned char n, z, p;
+  Register SEXT; // sign-extended immediate/offset for this opcode
+} Decoded;
+
+/* LC_3 class*/
+typedef struct lc {
+  CPU_s cpus;
+  LC3_Callbacks io;
+  Register start_address;
+  Register memory[MEM_SIZE];
+  Decoded decoded[MEM_SIZE];
+  unsigned int dirtyPages[DIRTY_WORDS]; // pages written since they were last decoded
+  unsigned long instructions; // instructions retired since resetCounters
+  Timing timing;
+  Perf perf;
+  int cacheTag[TIMING_MAX_LINES]; // line tag, -1 when empty
+} LC;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
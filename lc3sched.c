@@ -0,0 +1,390 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "lc3sched.h"
+#include "lc3internal.h"
+
+/**
+* Put a file descriptor in non-blocking mode.
+* @param fd file descriptor
+*/
+static void setNonBlocking(int fd) {
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/**
+* GETC callback: take the next buffered console character.
+* @param user session
+* @return character, or LC3_NO_INPUT to park the machine
+*/
+static int sessionRead(void *user) {
+	Session *s = user;
+	if (s->inCount == 0) return LC3_NO_INPUT;
+
+	char c = s->in[s->inStart];
+	s->inStart = (s->inStart + 1) % SESSION_INPUT;
+	s->inCount--;
+	return (unsigned char) c;
+}
+
+/**
+* OUT/PUTS callback: buffer a character until the slice ends.
+* @param user session
+* @param c character
+*/
+static void sessionWrite(void *user, char c) {
+	Session *s = user;
+	if (s->outLen == s->outCap) {
+		int cap = s->outCap ? s->outCap * 2 : SESSION_INPUT;
+		char *out = realloc(s->out, cap);
+		if (out == NULL) return; // drop output rather than stop the machine
+		s->out = out;
+		s->outCap = cap;
+	}
+	s->out[s->outLen++] = c;
+}
+
+/**
+* Add a session to the tail of the run queue.
+* @param sched scheduler
+* @param s session
+*/
+static void makeRunnable(Scheduler *sched, Session *s) {
+	s->state = SESSION_RUNNABLE;
+	s->nextRun = NULL;
+	if (sched->runTail != NULL) sched->runTail->nextRun = s;
+	else sched->runHead = s;
+	sched->runTail = s;
+}
+
+/**
+* Watch or stop watching the output side for EPOLLOUT.
+* @param sched scheduler
+* @param s session
+* @param watch 1 while output is pending
+*/
+static void watchOutput(Scheduler *sched, Session *s, int watch) {
+	if (watch == s->outWatched) return;
+
+	struct epoll_event ev;
+	ev.data.ptr = s;
+	if (s->outFd == s->inFd) {
+		ev.events = EPOLLIN | (watch ? EPOLLOUT : 0);
+		epoll_ctl(sched->epfd, EPOLL_CTL_MOD, s->outFd, &ev);
+	} else {
+		ev.events = EPOLLOUT;
+		epoll_ctl(sched->epfd, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, s->outFd, &ev);
+	}
+	s->outWatched = watch;
+}
+
+/**
+* Write as much pending output as the console accepts.
+* @param sched scheduler
+* @param s session
+*/
+static void flushOutput(Scheduler *sched, Session *s) {
+	while (s->outLen > 0) {
+		ssize_t n = write(s->outFd, s->out, s->outLen);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			s->outLen = 0; // console is gone
+			s->hungUp = 1;
+			break;
+		}
+		if (n <= 0) break;
+		memmove(s->out, s->out + n, s->outLen - n);
+		s->outLen -= n;
+	}
+	watchOutput(sched, s, s->outLen > 0);
+}
+
+/**
+* Read whatever console input is available into the session's buffer.
+* @param s session
+*/
+static void fillInput(Session *s) {
+	while (!s->eof && s->inCount < SESSION_INPUT) {
+		int end = (s->inStart + s->inCount) % SESSION_INPUT;
+		int room = end >= s->inStart ? SESSION_INPUT - end : s->inStart - end;
+		ssize_t n = read(s->inFd, s->in + end, room);
+		if (n < 0 && errno == EINTR) continue;
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+			s->eof = 1;
+			// a client closing its connection takes its output side with it
+			if (s->inFd == s->outFd) s->hungUp = 1;
+		}
+		if (n <= 0) break;
+		s->inCount += n;
+	}
+}
+
+/**
+* Close a session's console and free it.
+* @param sched scheduler
+* @param s session
+*/
+static void closeSession(Scheduler *sched, Session *s) {
+	Session **link;
+
+	lc3_stats_add(&sched->retired, s->lc);
+
+	epoll_ctl(sched->epfd, EPOLL_CTL_DEL, s->inFd, NULL);
+	close(s->inFd);
+	if (s->outFd != s->inFd) {
+		if (s->outWatched) epoll_ctl(sched->epfd, EPOLL_CTL_DEL, s->outFd, NULL);
+		close(s->outFd);
+	}
+
+	for (link = &sched->sessions; *link != s; link = &(*link)->next) {
+	}
+	*link = s->next;
+
+	lc3_destroy(s->lc);
+	free(s->out);
+	free(s);
+}
+
+/**
+* Finish a session: report its status, and close it once its output is
+* written. Until then it drains, woken only by EPOLLOUT on its console.
+* @param sched scheduler
+* @param s session
+* @param status final LC3_* status of the machine
+*/
+static void finish(Scheduler *sched, Session *s, int status) {
+	if (sched->onDone != NULL) sched->onDone(sched->user, s->lc, status);
+
+	s->state = SESSION_DRAINING;
+	flushOutput(sched, s);
+	if (s->outLen == 0) {
+		closeSession(sched, s);
+		return;
+	}
+
+	// stop reading, so a closed console cannot keep waking the loop
+	if (s->outFd == s->inFd) {
+		struct epoll_event ev;
+		ev.events = EPOLLOUT;
+		ev.data.ptr = s;
+		epoll_ctl(sched->epfd, EPOLL_CTL_MOD, s->outFd, &ev);
+	} else {
+		epoll_ctl(sched->epfd, EPOLL_CTL_DEL, s->inFd, NULL);
+	}
+}
+
+/**
+* Create a scheduler.
+* @param slice instructions per time slice, 0 for SCHED_SLICE
+* @return scheduler, or NULL on failure
+*/
+Scheduler * lc3_sched_create(unsigned long slice) {
+	Scheduler *sched = calloc(1, sizeof(Scheduler));
+	if (sched == NULL) return NULL;
+
+	sched->epfd = epoll_create1(0);
+	if (sched->epfd < 0) {
+		free(sched);
+		return NULL;
+	}
+	sched->listenFd = -1;
+	sched->slice = slice ? slice : SCHED_SLICE;
+	return sched;
+}
+
+/**
+* Destroy a scheduler, closing every session still attached. Output the
+* console does not take at once is dropped.
+* @param sched scheduler
+*/
+void lc3_sched_destroy(Scheduler *sched) {
+	while (sched->sessions != NULL) {
+		Session *s = sched->sessions;
+		if (s->state != SESSION_DRAINING && sched->onDone != NULL) {
+			sched->onDone(sched->user, s->lc, LC3_OK);
+		}
+		flushOutput(sched, s);
+		closeSession(sched, s);
+	}
+	if (sched->listenFd >= 0) close(sched->listenFd);
+	close(sched->epfd);
+	free(sched->image);
+	free(sched);
+}
+
+/**
+* Attach a machine and its console. The scheduler takes ownership of both
+* and installs its own console callbacks on the machine.
+* @param sched scheduler
+* @param lc LC class object, ready to run
+* @param inFd console input; a socket may be passed as both fds
+* @param outFd console output
+* @return session, or NULL on failure
+*/
+Session * lc3_sched_attach(Scheduler *sched, LC *lc, int inFd, int outFd) {
+	Session *s = calloc(1, sizeof(Session));
+	if (s == NULL) return NULL;
+
+	s->lc = lc;
+	s->inFd = inFd;
+	s->outFd = outFd;
+	setNonBlocking(inFd);
+	setNonBlocking(outFd);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = s;
+	if (epoll_ctl(sched->epfd, EPOLL_CTL_ADD, inFd, &ev) < 0) {
+		free(s);
+		return NULL;
+	}
+
+	LC3_Callbacks io = { sessionRead, sessionWrite, lc->io.trap, s };
+	lc3_set_callbacks(lc, &io);
+
+	s->next = sched->sessions;
+	sched->sessions = s;
+	makeRunnable(sched, s);
+	return s;
+}
+
+/**
+* Accept TCP connections on the loopback interface, giving each one its own
+* machine loaded with a hex image.
+* @param sched scheduler
+* @param port TCP port
+* @param image hex file for new sessions
+* @return LC3_OK, LC3_ERR_FILE if the socket cannot be opened or
+*         LC3_ERR_NOMEM
+*/
+int lc3_sched_listen(Scheduler *sched, unsigned short port, const char *image) {
+	struct sockaddr_in addr;
+	int one = 1;
+
+	sched->image = strdup(image);
+	if (sched->image == NULL) return LC3_ERR_NOMEM;
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) return LC3_ERR_FILE;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		close(fd);
+		return LC3_ERR_FILE;
+	}
+	setNonBlocking(fd);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = sched; // marks the listener
+	epoll_ctl(sched->epfd, EPOLL_CTL_ADD, fd, &ev);
+	sched->listenFd = fd;
+	return LC3_OK;
+}
+
+/**
+* Accept pending connections and start a machine for each.
+* @param sched scheduler
+*/
+static void acceptSessions(Scheduler *sched) {
+	int fd;
+	while ((fd = accept(sched->listenFd, NULL, NULL)) >= 0) {
+		LC *lc = lc3_create();
+		if (lc == NULL || lc3_load(lc, sched->image) != LC3_OK
+			|| lc3_sched_attach(sched, lc, fd, fd) == NULL) {
+			lc3_destroy(lc);
+			close(fd);
+		}
+	}
+}
+
+/**
+* Publish the counters of all machines, finished ones included.
+* @param sched scheduler
+*/
+static void publish(Scheduler *sched) {
+	Session *s;
+	if (sched->stats == NULL) return;
+
+	StatsSample sample = sched->retired;
+	sample.machines = 0; // live machines only
+	for (s = sched->sessions; s != NULL; s = s->next) {
+		lc3_stats_add(&sample, s->lc);
+	}
+	lc3_stats_publish(sched->stats, &sample, sched->runHead != NULL ? STATS_RUNNING : STATS_BLOCKED);
+}
+
+/**
+* Run until every session has finished and written its output (forever
+* while listening).
+* @param sched scheduler
+* @return LC3_OK, or LC3_ERR_FILE if epoll fails
+*/
+int lc3_sched_run(Scheduler *sched) {
+	struct epoll_event events[SCHED_EVENTS];
+
+	while (sched->sessions != NULL || sched->listenFd >= 0) {
+		int timeout = sched->runHead != NULL ? 0 : -1;
+		int n = epoll_wait(sched->epfd, events, SCHED_EVENTS, timeout);
+		if (n < 0 && errno != EINTR) return LC3_ERR_FILE;
+
+		int i;
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr == sched) {
+				acceptSessions(sched);
+				continue;
+			}
+			Session *s = events[i].data.ptr;
+			if (events[i].events & EPOLLOUT) flushOutput(sched, s);
+			if (s->state == SESSION_DRAINING) {
+				if (s->outLen == 0 || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+					closeSession(sched, s);
+				}
+				continue;
+			}
+			if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				fillInput(s);
+				// a parked machine retries its GETC, and finishes if the console closed
+				if (s->state == SESSION_BLOCKED && (s->inCount > 0 || s->eof)) {
+					makeRunnable(sched, s);
+				}
+			}
+		}
+
+		// one slice for every machine that was runnable at the start of the pass
+		Session *last = sched->runTail;
+		while (sched->runHead != NULL) {
+			Session *s = sched->runHead;
+			int isLast = s == last;
+			sched->runHead = s->nextRun;
+			if (sched->runHead == NULL) sched->runTail = NULL;
+
+			// nobody is left to type or read: stop the machine as lc3_sched_destroy would
+			if (s->eof && s->hungUp) {
+				finish(sched, s, LC3_OK);
+				if (isLast) break;
+				continue;
+			}
+
+			int status = lc3_run_for(s->lc, sched->slice);
+			flushOutput(sched, s);
+
+			if (status == LC3_OK) makeRunnable(sched, s);
+			else if (status == LC3_BLOCKED && !s->eof) s->state = SESSION_BLOCKED;
+			else finish(sched, s, status);
+			if (isLast) break;
+		}
+		publish(sched);
+	}
+	return LC3_OK;
+}
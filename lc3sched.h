@@ -0,0 +1,70 @@
+#ifndef LC3SCHED_H
+#define LC3SCHED_H
+
+/**
+* Event loop that multiplexes many LC-3 machines in one thread (Linux epoll).
+* Each session owns a machine and a console: a socket, or a pair of pipes.
+* Runnable machines get round-robin time slices of SCHED_SLICE instructions.
+* A machine whose GETC finds no input is parked until its console is readable.
+* Schedulers share nothing, so run one per thread to use several cores.
+*/
+
+#include "lc3core.h"
+#include "lc3stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCHED_SLICE 10000 // default instructions per time slice
+#define SCHED_EVENTS 64
+#define SESSION_INPUT 256
+
+#define SESSION_RUNNABLE 0
+#define SESSION_BLOCKED 1
+#define SESSION_DRAINING 2 // machine finished, writing the last output
+
+/* One simulated machine attached to its console.*/
+typedef struct session_s {
+  LC3 *lc;
+  int inFd, outFd;
+  int state;
+  int eof;         // console closed, no more input will come
+  int hungUp;      // output failed, or the peer closed the connection
+  int outWatched;  // outFd registered for EPOLLOUT
+  char in[SESSION_INPUT];
+  int inStart, inCount;
+  char *out;
+  int outLen, outCap;
+  struct session_s *next;    // all sessions
+  struct session_s *nextRun; // run queue
+} Session;
+
+/* Scheduler class.*/
+typedef struct scheduler_s {
+  int epfd;
+  int listenFd;            // -1 unless lc3_sched_listen was called
+  char *image;             // hex file loaded into every accepted session
+  unsigned long slice;
+  Session *sessions;
+  Session *runHead, *runTail;
+  void (*onDone)(void *user, LC3 *lc, int status); // called when a machine finishes
+  void *user;
+  StatsWriter *stats;      // published after every pass, NULL for none
+  StatsSample retired;     // counters of finished sessions
+} Scheduler;
+
+
+
+/** Functions Declarations.*/
+Scheduler * lc3_sched_create(unsigned long);
+void lc3_sched_destroy(Scheduler *);
+Session * lc3_sched_attach(Scheduler *, LC3 *, int, int);
+int lc3_sched_listen(Scheduler *, unsigned short, const char *);
+int lc3_sched_run(Scheduler *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lc3stats.h"
+#include "lc3internal.h"
+
+static const char * const stateNames[] = { "running", "halted", "blocked", "stopped", "error" };
+
+/**
+* Monotonic clock.
+* @return seconds
+*/
+static double now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+* Start an update: readers retry until endWrite.
+* @param segment shared segment
+*/
+static void beginWrite(StatsSegment *segment) {
+	__atomic_store_n(&segment->seq, segment->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+* Finish an update.
+* @param segment shared segment
+*/
+static void endWrite(StatsSegment *segment) {
+	__atomic_store_n(&segment->seq, segment->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+* Create this process's segment, /dev/shm/lc3-<pid>.
+* @param w writer to set up
+* @param image name of the loaded hex file
+* @return LC3_OK, or LC3_ERR_FILE (w then publishes nothing)
+*/
+int lc3_stats_open(StatsWriter *w, const char *image) {
+	memset(w, 0, sizeof(StatsWriter));
+	snprintf(w->name, STATS_NAME_SIZE, "/" STATS_PREFIX "%ld", (long) getpid());
+
+	int fd = shm_open(w->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return LC3_ERR_FILE;
+	void *p = MAP_FAILED;
+	if (ftruncate(fd, sizeof(StatsSegment)) == 0) {
+		p = mmap(NULL, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(w->name);
+		return LC3_ERR_FILE;
+	}
+
+	w->segment = p;
+	w->lastTime = now();
+	beginWrite(w->segment);
+	w->segment->pid = getpid();
+	w->segment->state = STATS_RUNNING;
+	strncpy(w->segment->image, image, STATS_IMAGE_SIZE - 1);
+	w->segment->magic = STATS_MAGIC;
+	endWrite(w->segment);
+	return LC3_OK;
+}
+
+/**
+* Remove the segment.
+* @param w writer
+*/
+void lc3_stats_close(StatsWriter *w) {
+	if (w->segment == NULL) return;
+	munmap(w->segment, sizeof(StatsSegment));
+	shm_unlink(w->name);
+	w->segment = NULL;
+}
+
+/**
+* Add a machine's counters to a sample.
+* @param sample sample, zeroed before the first machine
+* @param lc LC class object
+*/
+void lc3_stats_add(StatsSample *sample, const LC *lc) {
+	int i;
+	sample->instructions += lc->instructions;
+	for (i = 0; i < NO_OF_TRAPS; i++) {
+		sample->trapCount[i] += lc->perf.trapCount[i];
+	}
+	sample->pc = lc->cpus.PC | lc->start_address;
+	sample->machines++;
+}
+
+/**
+* Publish a sample. MIPS is refreshed once STATS_INTERVAL_MS have passed
+* since the last refresh, and is 0 while not running.
+* @param w writer
+* @param sample counters of the process
+* @param state STATS_* state
+*/
+void lc3_stats_publish(StatsWriter *w, const StatsSample *sample, int state) {
+	if (w->segment == NULL) return;
+
+	double t = now(), elapsed = t - w->lastTime;
+	if (state != STATS_RUNNING || sample->instructions < w->lastInstructions) {
+		w->mips = 0;
+	} else if (elapsed * 1000 >= STATS_INTERVAL_MS) {
+		w->mips = (sample->instructions - w->lastInstructions) / elapsed / 1e6;
+	} else {
+		elapsed = -1; // keep averaging over the current interval
+	}
+	if (elapsed >= 0) {
+		w->lastTime = t;
+		w->lastInstructions = sample->instructions;
+	}
+
+	beginWrite(w->segment);
+	w->segment->state = state;
+	w->segment->sample = *sample;
+	w->segment->mips = w->mips;
+	endWrite(w->segment);
+}
+
+/**
+* Publish the counters of a single machine.
+* @param w writer
+* @param lc LC class object
+* @param state STATS_* state
+*/
+void lc3_stats_publish_lc(StatsWriter *w, const LC *lc, int state) {
+	StatsSample sample;
+	memset(&sample, 0, sizeof(sample));
+	lc3_stats_add(&sample, lc);
+	lc3_stats_publish(w, &sample, state);
+}
+
+/**
+* Change only the state, e.g. around a blocking read of the console.
+* @param w writer
+* @param state STATS_* state
+*/
+void lc3_stats_set_state(StatsWriter *w, int state) {
+	if (w->segment == NULL) return;
+	beginWrite(w->segment);
+	w->segment->state = state;
+	if (state != STATS_RUNNING) w->segment->mips = 0;
+	endWrite(w->segment);
+}
+
+/**
+* State to publish once a run ends with a status.
+* @param status LC3_* status
+* @return STATS_* state
+*/
+int lc3_stats_state_of(int status) {
+	switch (status) {
+		case LC3_OK: return STATS_STOPPED;
+		case LC3_HALTED: return STATS_HALTED;
+		case LC3_BLOCKED: return STATS_BLOCKED;
+	}
+	return STATS_ERROR;
+}
+
+/**
+* Name of a state.
+* @param state STATS_* state
+* @return name
+*/
+const char * lc3_stats_state_name(int state) {
+	if (state < STATS_RUNNING || state > STATS_ERROR) return "?";
+	return stateNames[state];
+}
+
+/**
+* Take a consistent copy of a segment.
+* @param name segment name, as listed in /dev/shm
+* @param copy filled with the segment
+* @return LC3_OK, or LC3_ERR_FILE if it is missing, not a segment, or
+* could not be read between updates
+*/
+int lc3_stats_read(const char *name, StatsSegment *copy) {
+	char path[STATS_NAME_SIZE + 256];
+	struct stat st;
+	int tries;
+
+	snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+	int fd = shm_open(path, O_RDONLY, 0);
+	if (fd < 0) return LC3_ERR_FILE;
+	const StatsSegment *segment = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof(StatsSegment)) {
+		segment = mmap(NULL, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (segment == MAP_FAILED) return LC3_ERR_FILE;
+
+	int status = LC3_ERR_FILE;
+	for (tries = 0; tries < STATS_READ_TRIES && status != LC3_OK; tries++) {
+		unsigned int seq = __atomic_load_n(&segment->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) continue;
+		memcpy(copy, segment, sizeof(StatsSegment));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&segment->seq, __ATOMIC_RELAXED) == seq) status = LC3_OK;
+	}
+	munmap((void *) segment, sizeof(StatsSegment));
+
+	if (status == LC3_OK && copy->magic != STATS_MAGIC) status = LC3_ERR_FILE;
+	return status;
+}
@@ -0,0 +1,79 @@
+#ifndef LC3STATS_H
+#define LC3STATS_H
+
+/**
+* Live statistics of a simulator process in POSIX shared memory
+* (/dev/shm/lc3-<pid>), for monitors such as lc3top.
+* The process writes a StatsSegment between time slices, never from inside
+* the execution loop. Updates are guarded by a seqlock: the writer makes
+* seq odd, stores the fields and makes it even again, and a reader retries
+* until it copied the segment with the same even seq before and after.
+*/
+
+#include "lc3core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_MAGIC 0x4C335331 // "LC3S" version 1
+#define STATS_PREFIX "lc3-"
+#define STATS_DIR "/dev/shm"
+#define STATS_NAME_SIZE 32
+#define STATS_IMAGE_SIZE 128
+#define STATS_INTERVAL_MS 500 // MIPS is averaged over at least this long
+#define STATS_SLICE 1000000 // instructions between updates in batch runs
+#define STATS_READ_TRIES 1000
+
+#define STATS_RUNNING 0
+#define STATS_HALTED 1
+#define STATS_BLOCKED 2 // waiting for console input
+#define STATS_STOPPED 3 // budget spent, or stopped in the debugger
+#define STATS_ERROR 4
+
+/* Counters summed over the machines of a process.*/
+typedef struct stats_sample_s {
+  unsigned long instructions;
+  unsigned long trapCount[LC3_NO_OF_TRAPS];
+  LC3_Word pc;  // of the last machine added
+  int machines;
+} StatsSample;
+
+/* Shared segment layout.*/
+typedef struct stats_segment_s {
+  unsigned int magic;
+  unsigned int seq; // odd while an update is in progress
+  long pid;
+  int state;
+  StatsSample sample;
+  double mips;      // over the last interval
+  char image[STATS_IMAGE_SIZE];
+} StatsSegment;
+
+/* Writer class, private to the publishing process.*/
+typedef struct stats_writer_s {
+  StatsSegment *segment; // NULL when shared memory is unavailable
+  char name[STATS_NAME_SIZE];
+  unsigned long lastInstructions;
+  double lastTime;
+  double mips;
+} StatsWriter;
+
+
+
+/** Functions Declarations.*/
+int lc3_stats_open(StatsWriter *, const char *);
+void lc3_stats_close(StatsWriter *);
+void lc3_stats_add(StatsSample *, const LC3 *);
+void lc3_stats_publish(StatsWriter *, const StatsSample *, int);
+void lc3_stats_publish_lc(StatsWriter *, const LC3 *, int);
+void lc3_stats_set_state(StatsWriter *, int);
+int lc3_stats_state_of(int);
+const char * lc3_stats_state_name(int);
+int lc3_stats_read(const char *, StatsSegment *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
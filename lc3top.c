@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include "lc3stats.h"
+/**
+* lc3top lists the LC-3 simulators running on this host, read from their
+* shared statistics segments (see lc3stats.h).
+*
+*   Usage: lc3top            print the table once
+*          lc3top -d secs    refresh every secs seconds until interrupted
+*
+* Segments left behind by processes that died are removed.
+* *Note*: Please compile using "gcc lc3top.c lc3stats.c -o lc3top"
+*/
+
+
+
+
+/**
+* Print one row per simulator process, and the totals.
+* @return 0, or 1 if the segments cannot be listed
+*/
+static int show(void) {
+	char path[STATS_NAME_SIZE + 256];
+	struct dirent *entry;
+	StatsSegment segment;
+	int processes = 0, machines = 0;
+	double mips = 0;
+
+	DIR *dir = opendir(STATS_DIR);
+	if (dir == NULL) {
+		perror(STATS_DIR);
+		return 1;
+	}
+
+	printf("%7s %-8s %4s %14s %9s %5s %8s %8s %8s %6s %6s  %s\n", "PID", "STATE", "MACH",
+		"INSTRUCTIONS", "MIPS", "PC", "GETC", "OUT", "PUTS", "HALT", "OTHER", "IMAGE");
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, STATS_PREFIX, strlen(STATS_PREFIX)) != 0) continue;
+		if (lc3_stats_read(entry->d_name, &segment) != LC3_OK) continue;
+		if (kill(segment.pid, 0) < 0 && errno == ESRCH) {
+			snprintf(path, sizeof(path), "/%s", entry->d_name);
+			shm_unlink(path);
+			continue;
+		}
+
+		const StatsSample *s = &segment.sample;
+		printf("%7ld %-8s %4d %14lu %9.2f x%04X %8lu %8lu %8lu %6lu %6lu  %s\n",
+			segment.pid, lc3_stats_state_name(segment.state), s->machines, s->instructions,
+			segment.mips, s->pc, s->trapCount[0], s->trapCount[1], s->trapCount[2],
+			s->trapCount[3], s->trapCount[LC3_TRAP_OTHER], segment.image);
+		processes++;
+		machines += s->machines;
+		mips += segment.mips;
+	}
+	closedir(dir);
+
+	printf("%d processes, %d machines, %.2f MIPS\n", processes, machines, mips);
+	fflush(stdout);
+	return 0;
+}
+
+/**
+* Main class to executes the program.
+*/
+int main(int argc, char **argv) {
+	unsigned int delay = 0;
+
+	if (argc == 3 && strcmp(argv[1], "-d") == 0) delay = atoi(argv[2]);
+	else if (argc != 1) {
+		fprintf(stderr, "usage: lc3top [-d secs]\n");
+		return 1;
+	}
+	if (delay == 0) return show();
+
+	for (;;) {
+		printf("\033[H\033[J"); // clear the terminal
+		if (show() != 0) return 1;
+		sleep(delay);
+	}
+}
@@ -1,4 +1,10 @@
+#include <string.h>
+#include <signal.h>
 #include "lc3N.h"
+#include "lc3sched.h"
+#include "lc3cache.h"
+#include "lc3gdb.h"
+#include "lc3stats.h"
 /**
 * @Program Outlines: 
 *	This program should implements the LC-3 instructions except LDI, RTI, STI, and mimicks the LC-3 simulator. 
@@ -23,26 +29,242 @@
 *    
 *   This program utilizes ncurses.c library in C.
 *
+*   Usage: main                  interactive ncurses simulator
+*          main -l port file.hex serve one machine per TCP connection on localhost
+*          main -r file.hex [max] run headless on stdin/stdout, report on stderr
+*          main -c dir -r file.hex [max]  same, reusing results cached in dir
+*          main -g port|path file.hex  wait for a GDB remote protocol client
+*          lc3top [-d secs]      list the simulators running on this host
+*
 * @Authors: Vecheka Chhourn, Sally Ho, David Chau, Grant Christopher Schorbach
 * @Date: 11/27/2018 version 2.0
-* *Note*: Please compile using "gcc mainN.c lc3N.c -lncurses"             
+* *Note*: Please compile using "gcc mainN.c lc3N.c lc3core.c lc3sched.c lc3cache.c lc3gdb.c lc3stats.c -lncurses"             
 *
 */
 
 
 
 
+/**
+* Print the final machine state and the performance counters.
+* @param lc LC class object
+* @param status status the run ended with
+*/
+static void report(LC *lc, int status) {
+	int i;
+	char text[STRING_SIZE];
+	
+	fprintf(stderr, "\nStatus: %s\n", lc3_strerror(status));
+	for (i = 0; i < NO_OF_REGISTERS; i++) {
+		fprintf(stderr, "R%d: x%04X%s", i, lc->cpus.reg_file[i], i % 4 == 3 ? "\n" : "  ");
+	}
+	fprintf(stderr, "PC: x%04X  IR: x%04X (%s)  CC: N=%d Z=%d P=%d\n",
+		lc->cpus.PC | lc->start_address, lc->cpus.IR,
+		lc3_disassemble(lc->cpus.IR, text, STRING_SIZE), lc->cpus.n, lc->cpus.z, lc->cpus.p);
+	
+	fprintf(stderr, "Instructions: %lu  Cycles: %lu  CPI: %.2f\n",
+		lc->instructions, lc->perf.cycles, lc3_cpi(lc, ALL_OPCODES));
+	fprintf(stderr, "Stalls: fetch %lu  load %lu  store %lu\n",
+		lc->perf.fetchStalls, lc->perf.loadStalls, lc->perf.storeStalls);
+	if (lc->timing.cacheLines > 0) {
+		fprintf(stderr, "Cache: %lu hits  %lu misses\n", lc->perf.cacheHits, lc->perf.cacheMisses);
+	}
+	fprintf(stderr, "Traps: GETC %lu  OUT %lu  PUTS %lu  HALT %lu  other %lu\n",
+		lc->perf.trapCount[0], lc->perf.trapCount[1], lc->perf.trapCount[2],
+		lc->perf.trapCount[3], lc->perf.trapCount[TRAP_OTHER]);
+	for (i = 0; i < NO_OF_OPCODES; i++) {
+		if (lc->perf.opcodeCount[i] == 0) continue;
+		fprintf(stderr, "  %-4s %10lu  CPI %.2f\n", lc3_opcode_name(i),
+			lc->perf.opcodeCount[i], lc3_cpi(lc, i));
+	}
+}
+
+/**
+* Read all of stdin, the input stream of a cached run.
+* @param len set to the number of bytes read
+* @return the bytes, or NULL when out of memory
+*/
+static char * readInput(size_t *len) {
+	size_t cap = STRING_SIZE, n;
+	char *input = malloc(cap);
+	
+	*len = 0;
+	while (input != NULL && (n = fread(input + *len, 1, cap - *len, stdin)) > 0) {
+		*len += n;
+		if (*len < cap) continue;
+		char *grown = realloc(input, cap *= 2);
+		if (grown == NULL) free(input);
+		input = grown;
+	}
+	return input;
+}
+
+/**
+* Run through the result cache, replaying an identical earlier run if any.
+* @param lc LC class object, loaded
+* @param dir cache directory
+* @param budget maximum instructions, 0 for no limit
+* @return status the run ended with
+*/
+static int cachedRun(LC *lc, char *dir, unsigned long budget) {
+	ResultCache cache;
+	Result result;
+	size_t len;
+	
+	int status = lc3_cache_open(&cache, dir);
+	if (status != LC3_OK) return status;
+	char *input = readInput(&len);
+	if (input == NULL) return LC3_ERR_NOMEM;
+	
+	status = lc3_cache_run(&cache, lc, input, len, budget, &result);
+	fwrite(result.output, 1, result.outputLen, stdout);
+	fflush(stdout);
+	fprintf(stderr, "\nResult cache: %s  (%lu hits, %lu misses in %s)",
+		cache.hits ? "hit" : cache.bypassed ? "bypassed" : "miss",
+		cache.totalHits, cache.totalMisses, dir);
+	
+	lc3_cache_free_result(&result);
+	free(input);
+	return status;
+}
+
+/**
+* GETC callback of a batch run: read stdin, published as blocked meanwhile.
+* @param user stats writer
+* @return character, or LC3_NO_INPUT at the end of stdin
+*/
+static int readStdin(void *user) {
+	lc3_stats_set_state(user, STATS_BLOCKED);
+	int c = getchar();
+	lc3_stats_set_state(user, STATS_RUNNING);
+	return c == EOF ? LC3_NO_INPUT : c;
+}
+
+/**
+* Run in slices of STATS_SLICE instructions, publishing after each one.
+* @param lc LC class object, loaded
+* @param budget maximum instructions, 0 for no limit
+* @param stats stats writer
+* @return status the run ended with
+*/
+static int publishedRun(LC *lc, unsigned long budget, StatsWriter *stats) {
+	LC3_Callbacks io = { readStdin, NULL, NULL, stats };
+	int status, unlimited = budget == 0;
+	
+	lc3_set_callbacks(lc, &io);
+	do {
+		unsigned long slice = unlimited || budget > STATS_SLICE ? STATS_SLICE : budget;
+		status = lc3_run_for(lc, slice);
+		if (!unlimited) budget -= slice;
+		if (status == LC3_OK) lc3_stats_publish_lc(stats, lc, STATS_RUNNING);
+	} while (status == LC3_OK && (unlimited || budget > 0));
+	lc3_set_callbacks(lc, NULL);
+	return status;
+}
+
+/**
+* Run a program without the ncurses front end.
+* @param image hex file
+* @param budget maximum instructions, 0 for no limit
+* @param cacheDir result cache directory, or NULL to always execute
+* @return exit code, 0 once the program halted
+*/
+static int batch(char *image, unsigned long budget, char *cacheDir) {
+	StatsWriter stats;
+	LC *lc = lc3_create();
+	if (lc == NULL) return 1;
+	
+	lc3_stats_open(&stats, image); // runs the same without a segment
+	int status = lc3_load(lc, image);
+	if (status == LC3_OK && cacheDir != NULL) status = cachedRun(lc, cacheDir, budget);
+	else if (status == LC3_OK) status = publishedRun(lc, budget, &stats);
+	lc3_stats_publish_lc(&stats, lc, lc3_stats_state_of(status));
+	fflush(stdout);
+	report(lc, status);
+	
+	lc3_stats_close(&stats);
+	lc3_destroy(lc);
+	return status == LC3_HALTED ? 0 : 1;
+}
+
+/**
+* Serve interactive sessions over TCP until killed.
+* @param port TCP port on localhost
+* @param image hex file loaded into every new machine
+* @return exit code
+*/
+static int serve(int port, char *image) {
+	Scheduler *sched = lc3_sched_create(0);
+	if (sched == NULL) return 1;
+	signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the server
+	
+	StatsWriter stats;
+	lc3_stats_open(&stats, image);
+	sched->stats = &stats;
+	
+	int status = lc3_sched_listen(sched, port, image);
+	if (status == LC3_OK) status = lc3_sched_run(sched);
+	if (status != LC3_OK) fprintf(stderr, "%s\n", lc3_strerror(status));
+	
+	lc3_sched_destroy(sched);
+	lc3_stats_close(&stats);
+	return status == LC3_OK ? 0 : 1;
+}
+
+
+/**
+* Debug a program headless through the GDB remote protocol.
+* @param where TCP port on localhost, or Unix socket path
+* @param image hex file
+* @return exit code
+*/
+static int debug(char *where, char *image) {
+	LC *lc = lc3_create();
+	if (lc == NULL) return 1;
+	
+	StatsWriter stats;
+	lc3_stats_open(&stats, image);
+	lc3_stats_set_state(&stats, STATS_STOPPED);
+	
+	int status = lc3_load(lc, image);
+	int fd = status == LC3_OK ? lc3_gdb_listen(where) : -1;
+	if (fd >= 0) {
+		fprintf(stderr, "Waiting for gdb on %s\n", where);
+		status = lc3_gdb_serve(lc, fd, &stats);
+		close(fd);
+	} else if (status == LC3_OK) status = LC3_ERR_FILE;
+	if (status != LC3_OK) fprintf(stderr, "%s\n", lc3_strerror(status));
+	
+	lc3_stats_close(&stats);
+	lc3_destroy(lc);
+	return status == LC3_OK ? 0 : 1;
+}
+
+
 /**
 * Main class to executes the program.
 */
-int main(void) {
+int main(int argc, char **argv) {
+	
+	char *cacheDir = NULL;
+	if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+		cacheDir = argv[2];
+		argc -= 2;
+		argv += 2;
+	}
+	
+	if (argc == 4 && strcmp(argv[1], "-l") == 0) return serve(atoi(argv[2]), argv[3]);
+	if (argc == 4 && strcmp(argv[1], "-g") == 0) return debug(argv[2], argv[3]);
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "-r") == 0) {
+		return batch(argv[2], argc == 4 ? strtoul(argv[3], NULL, 10) : 0, cacheDir);
+	}
 
-	LC *lc = malloc(sizeof(LC));
-	initialize(lc);	// initialize registers, and cpu at the start
+	LC *lc = lc3_create();	// initialize registers, and cpu at the start
+	if (lc == NULL) return 1;
 	
 	run(lc);
 	
-	free(lc);
+	lc3_destroy(lc);
 	
 	return 0;
 }	
\ No newline at end of file
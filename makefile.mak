@@ -1,2 +1,22 @@
-lc3N: lc3N.c mainN.c 
-	gcc -o main lc3N.c mainN.c -lncurses -I.
\ No newline at end of file
+lc3N: lc3N.c mainN.c lc3core.c lc3core.h lc3internal.h lc3isa.def lc3sched.c lc3sched.h lc3cache.c lc3cache.h lc3gdb.c lc3gdb.h lc3stats.c lc3stats.h
+	gcc -o main lc3N.c mainN.c lc3core.c lc3sched.c lc3cache.c lc3gdb.c lc3stats.c -lncurses -I.
+
+lib: liblc3.a liblc3.so
+
+liblc3.a: lc3core.c lc3core.h lc3internal.h lc3isa.def lc3sched.c lc3sched.h lc3cache.c lc3cache.h lc3gdb.c lc3gdb.h lc3stats.c lc3stats.h
+	gcc -c -fPIC -o lc3core.o lc3core.c -I.
+	gcc -c -fPIC -o lc3sched.o lc3sched.c -I.
+	gcc -c -fPIC -o lc3cache.o lc3cache.c -I.
+	gcc -c -fPIC -o lc3gdb.o lc3gdb.c -I.
+	gcc -c -fPIC -o lc3stats.o lc3stats.c -I.
+	ar rcs liblc3.a lc3core.o lc3sched.o lc3cache.o lc3gdb.o lc3stats.o
+
+liblc3.so: lc3core.c lc3core.h lc3internal.h lc3isa.def lc3sched.c lc3sched.h lc3cache.c lc3cache.h lc3gdb.c lc3gdb.h lc3stats.c lc3stats.h
+	gcc -shared -fPIC -Wl,-soname,liblc3.so.3 -o liblc3.so.3 lc3core.c lc3sched.c lc3cache.c lc3gdb.c lc3stats.c -I.
+	ln -sf liblc3.so.3 liblc3.so
+
+lc3top: lc3top.c lc3stats.c lc3stats.h lc3core.h
+	gcc -o lc3top lc3top.c lc3stats.c -I.
+
+clean:
+	rm -f main lc3top lc3core.o lc3sched.o lc3cache.o lc3gdb.o lc3stats.o liblc3.a liblc3.so liblc3.so.3
\ No newline at end of file